@@ -0,0 +1,466 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <cmath>
+#include <chrono>
+
+#include "libs/huffman.hpp"
+#include "libs/static_huffman.hpp"
+#include "libs/block_huffman.hpp"
+#include "libs/bitarray.hpp"
+#include "libs/io.hpp"
+
+/*
+ * Throughput of every engine (encode/decode MB/s, ns/byte, ratio)
+ * on txt/ files and synthetic data, and BitArray microbenchmarks.
+ * Results go to stdout and to a JSON file, for diffing between releases.
+ * Usage: ./bench [directory, default txt] [--size bytes (K/M/G suffix), default 4M]
+ *                [--json file, default bench.json] [--no-coding] [--no-bitarray]
+ */
+
+using namespace std::chrono;
+
+// keeps benchmarked results alive
+volatile uint64_t sink;
+
+/*
+ * Best time of a few runs: at least 200 ms in total,
+ * at least 3 runs unless one run takes over a second
+ * (setup before each run isn't timed)
+ */
+double best_seconds(const std::function<void()>& run, const std::function<void()>& setup = nullptr) {
+    double best = 1e100;
+    auto bench_start = steady_clock::now();
+
+    for (int runs=1; ; runs++) {
+        if (setup) {
+            setup();
+        }
+
+        auto start = steady_clock::now();
+        run();
+        auto stop = steady_clock::now();
+
+        best = std::min(best, duration_cast<duration<double>>(stop - start).count());
+
+        auto elapsed = stop - bench_start;
+        if (elapsed >= milliseconds(200) && (runs >= 3 || elapsed >= seconds(1))) {
+            break;
+        }
+    }
+
+    return best;
+}
+
+
+/*
+ * Input data
+ */
+struct Data {
+    std::string name;
+    std::string bytes;
+};
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream raw;
+    raw << in.rdbuf();
+    return raw.str();
+}
+
+std::vector<Data> synthetic(size_t size) {
+    std::mt19937_64 gen(1);
+    std::vector<Data> data;
+
+    Data uniform{ "uniform", std::string(size, '\0') };
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (char& c : uniform.bytes) {
+        c = byte(gen);
+    }
+    data.push_back(std::move(uniform));
+
+    // s = 1.1 over byte values (0 the most frequent)
+    std::vector<double> weights;
+    for (int k=1; k<=256; k++) {
+        weights.push_back(1 / std::pow(k, 1.1));
+    }
+    std::discrete_distribution<int> zipf_byte(weights.begin(), weights.end());
+    Data zipf{ "zipf", std::string(size, '\0') };
+    for (char& c : zipf.bytes) {
+        c = zipf_byte(gen);
+    }
+    data.push_back(std::move(zipf));
+
+    // random bytes repeated 64 times on average
+    std::geometric_distribution<size_t> run_length(1 / 64.);
+    Data runs{ "runs", "" };
+    runs.bytes.reserve(size);
+    while (runs.bytes.size() < size) {
+        runs.bytes.append(std::min(run_length(gen) + 1, size - runs.bytes.size()), byte(gen));
+    }
+    data.push_back(std::move(runs));
+
+    // records of counter, small number and random word, all 256 values present
+    Data binary{ "binary", "" };
+    binary.bytes.reserve(size + 16);
+    std::uniform_int_distribution<uint32_t> small(0, 999);
+    for (uint32_t i=0; binary.bytes.size() < size; i++) {
+        uint32_t words[2] = { i, small(gen) };
+        uint64_t random = gen();
+        binary.bytes.append((const char*)words, sizeof(words));
+        binary.bytes.append((const char*)&random, sizeof(random));
+    }
+    binary.bytes.resize(size);
+    data.push_back(std::move(binary));
+
+    return data;
+}
+
+
+/*
+ * Coding benchmarks
+ */
+struct Engine {
+    std::string name;
+    // buffer is frame or block size
+    std::function<void(hf::io::Source&, hf::io::Sink&, uint32_t buffer)> encode;
+    std::function<void(hf::io::Source&, hf::io::Sink&)> decode;
+};
+
+template<typename Coder>
+Coder& quiet(Coder& coder) {
+    coder.set_verbose(false);
+    return coder;
+}
+
+std::vector<Engine> engines() {
+    using hf::io::Source;
+    using hf::io::Sink;
+
+    auto adaptive_encode = [](detail::Updater updater) {
+        return [updater](Source& src, Sink& dest, uint32_t buffer) {
+            hf::Huffman coder(src, dest, updater);
+            quiet(coder).set_frame_size(buffer);
+            coder.encode();
+        };
+    };
+
+    auto adaptive_decode = [](bool table_decoder) {
+        return [table_decoder](Source& src, Sink& dest) {
+            hf::Huffman coder(src, dest);
+            quiet(coder).set_table_decoder(table_decoder);
+            coder.decode();
+        };
+    };
+
+    return {
+        { "adaptive", adaptive_encode(detail::FGK), adaptive_decode(true) },
+        { "adaptive-walker", adaptive_encode(detail::FGK), adaptive_decode(false) },
+        { "vitter", adaptive_encode(detail::VITTER), adaptive_decode(true) },
+        {
+            "static",
+            [](Source& src, Sink& dest, uint32_t buffer) {
+                hf::StaticHuffman coder(src, dest);
+                quiet(coder).set_frame_size(buffer);
+                coder.encode();
+            },
+            [](Source& src, Sink& dest) {
+                hf::StaticHuffman coder(src, dest);
+                quiet(coder).decode();
+            }
+        },
+        {
+            "block",
+            [](Source& src, Sink& dest, uint32_t buffer) {
+                hf::BlockHuffman coder(src, dest);
+                quiet(coder).set_block_size(buffer);
+                coder.encode();
+            },
+            [](Source& src, Sink& dest) {
+                hf::BlockHuffman coder(src, dest);
+                quiet(coder).decode();
+            }
+        },
+    };
+}
+
+struct CodingResult {
+    std::string data;
+    size_t bytes;
+    std::string engine;
+    uint32_t buffer;
+    size_t packed;
+    double encode_seconds;
+    double decode_seconds;
+};
+
+CodingResult bench_coding(const Data& data, const Engine& engine, uint32_t buffer) {
+    const std::string& raw = data.bytes;
+    std::string packed;
+    std::string decoded;
+
+    double encode_seconds = best_seconds([&]() {
+        packed.clear();
+        hf::io::MemorySource src(raw.data(), raw.size());
+        hf::io::StringSink dest(packed);
+        engine.encode(src, dest, buffer);
+    });
+
+    double decode_seconds = best_seconds([&]() {
+        decoded.clear();
+        hf::io::MemorySource src(packed.data(), packed.size());
+        hf::io::StringSink dest(decoded);
+        engine.decode(src, dest);
+    });
+
+    if (decoded != raw) {
+        throw std::runtime_error(engine.name + ": round trip failed on " + data.name);
+    }
+
+    return { data.name, raw.size(), engine.name, buffer, packed.size(), encode_seconds, decode_seconds };
+}
+
+
+/*
+ * BitArray microbenchmarks (ns per operation)
+ */
+struct BitArrayResult {
+    std::string cell;
+    std::string op;
+    double ns_per_op;
+};
+
+const size_t BITARRAY_OPS = 1 << 20;
+
+template<typename Cell>
+void bench_bitarray(const std::string& cell, std::vector<BitArrayResult>& results) {
+    using bitarr::BitArray;
+    const size_t bits_per_cell = sizeof(Cell) * 8;
+
+    auto add = [&](const std::string& op, double seconds) {
+        results.push_back({ cell, op, seconds * 1e9 / BITARRAY_OPS });
+    };
+
+    // working buffer of a coder: at most 2 cells, oldest bits dropped
+    add("<<=", best_seconds([&]() {
+        BitArray<Cell> bits;
+        for (size_t i=0; i<BITARRAY_OPS; i++) {
+            bits <<= 3;
+            bits |= (uint8_t)(i & 1);
+            if (bits.get_bits_used() >= 2 * bits_per_cell) {
+                bits.drop_bits(bits_per_cell);
+            }
+        }
+        sink = bits.get_cell(0);
+    }));
+
+    BitArray<Cell> code("1011001110101");
+    add("+=", best_seconds([&]() {
+        BitArray<Cell> bits;
+        for (size_t i=0; i<BITARRAY_OPS; i++) {
+            bits += code;
+            while (bits.get_bits_used() >= 2 * bits_per_cell) {
+                bits.drop_bits(bits_per_cell);
+            }
+        }
+        sink = bits.get_cell(0);
+    }));
+
+    // filled up front, so only trimming is timed
+    BitArray<Cell> filled;
+    filled <<= BITARRAY_OPS * bits_per_cell + 5;
+    filled |= (uint8_t)1;
+
+    BitArray<Cell> bits;
+    auto refill = [&]() { bits = filled; };
+
+    add("trim_cell_into", best_seconds([&]() {
+        uint8_t buf[sizeof(Cell)];
+        size_t n_bytes;
+        uint64_t sum = 0;
+        for (size_t i=0; i<BITARRAY_OPS; i++) {
+            bits.trim_cell_into(buf, n_bytes);
+            sum += buf[0] + n_bytes;
+        }
+        sink = sum;
+    }, refill));
+
+    add("trim_bit", best_seconds([&]() {
+        uint64_t sum = 0;
+        for (size_t i=0; i<BITARRAY_OPS; i++) {
+            sum += bits.trim_bit();
+        }
+        sink = sum;
+    }, refill));
+}
+
+
+/*
+ * Output
+ */
+std::string json_string(const std::string& str) {
+    std::string quoted = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+void write_json(std::ostream& os, size_t synthetic_size,
+                const std::vector<CodingResult>& coding, const std::vector<BitArrayResult>& bitarray) {
+
+    os << std::fixed << std::setprecision(3);
+    os << "{\n";
+    os << "  \"synthetic_size\": " << synthetic_size << ",\n";
+
+    os << "  \"coding\": [";
+    for (size_t i=0; i<coding.size(); i++) {
+        const CodingResult& r = coding[i];
+        os << (i ? "," : "") << "\n    {"
+           << "\"data\": " << json_string(r.data)
+           << ", \"bytes\": " << r.bytes
+           << ", \"engine\": " << json_string(r.engine)
+           << ", \"buffer\": " << r.buffer
+           << ", \"packed\": " << r.packed
+           << ", \"ratio\": " << (r.bytes ? (double)r.packed / r.bytes : 0)
+           << ", \"encode_mbps\": " << r.bytes / r.encode_seconds / 1e6
+           << ", \"encode_ns_per_byte\": " << (r.bytes ? r.encode_seconds * 1e9 / r.bytes : 0)
+           << ", \"decode_mbps\": " << r.bytes / r.decode_seconds / 1e6
+           << ", \"decode_ns_per_byte\": " << (r.bytes ? r.decode_seconds * 1e9 / r.bytes : 0)
+           << "}";
+    }
+    os << "\n  ],\n";
+
+    os << "  \"bitarray\": [";
+    for (size_t i=0; i<bitarray.size(); i++) {
+        const BitArrayResult& r = bitarray[i];
+        os << (i ? "," : "") << "\n    {"
+           << "\"cell\": " << json_string(r.cell)
+           << ", \"op\": " << json_string(r.op)
+           << ", \"ns_per_op\": " << r.ns_per_op
+           << "}";
+    }
+    os << "\n  ]\n";
+    os << "}\n";
+}
+
+// 4096, 64K, 16M, 2G
+size_t parse_size(const std::string& str) {
+    size_t pos;
+    size_t size = std::stoull(str, &pos);
+    std::string suffix = str.substr(pos);
+
+    if (suffix == "K") return size << 10;
+    if (suffix == "M") return size << 20;
+    if (suffix == "G") return size << 30;
+    if (suffix.empty()) return size;
+
+    throw std::invalid_argument("bad size: " + str);
+}
+
+int main(int argc, char** argv) {
+    std::string dir = "txt";
+    std::string json_path = "bench.json";
+    size_t synthetic_size = 4 << 20;
+    bool coding = true;
+    bool bitarray = true;
+
+    for (int i=1; i<argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i+1 < argc) {
+            synthetic_size = parse_size(argv[++i]);
+        }
+        else if (arg == "--json" && i+1 < argc) {
+            json_path = argv[++i];
+        }
+        else if (arg == "--no-coding") {
+            coding = false;
+        }
+        else if (arg == "--no-bitarray") {
+            bitarray = false;
+        }
+        else {
+            dir = arg;
+        }
+    }
+
+    std::vector<CodingResult> coding_results;
+    std::vector<BitArrayResult> bitarray_results;
+
+    if (coding) {
+        std::vector<Data> data;
+
+        std::vector<std::string> files;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.is_regular_file()) {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        for (const std::string& file : files) {
+            data.push_back({ file, read_file(file) });
+        }
+
+        for (Data& generated : synthetic(synthetic_size)) {
+            data.push_back(std::move(generated));
+        }
+
+        cout << std::left << std::setw(32) << "data" << std::setw(17) << "engine" << std::right
+             << std::setw(10) << "buffer"
+             << std::setw(8) << "ratio"
+             << std::setw(12) << "enc MB/s"
+             << std::setw(12) << "dec MB/s"
+             << std::setw(12) << "enc ns/B"
+             << std::setw(12) << "dec ns/B" << endl;
+
+        for (const Data& d : data) {
+            for (const Engine& engine : engines()) {
+                for (uint32_t buffer : { 64u << 10, 1u << 20 }) {
+                    CodingResult r = bench_coding(d, engine, buffer);
+                    coding_results.push_back(r);
+
+                    cout << std::left << std::setw(32) << r.data << std::setw(17) << r.engine << std::right
+                         << std::setw(10) << r.buffer << std::fixed << std::setprecision(3)
+                         << std::setw(8) << (r.bytes ? (double)r.packed / r.bytes : 0) << std::setprecision(2)
+                         << std::setw(12) << r.bytes / r.encode_seconds / 1e6
+                         << std::setw(12) << r.bytes / r.decode_seconds / 1e6
+                         << std::setw(12) << (r.bytes ? r.encode_seconds * 1e9 / r.bytes : 0)
+                         << std::setw(12) << (r.bytes ? r.decode_seconds * 1e9 / r.bytes : 0) << endl;
+                }
+            }
+        }
+    }
+
+    if (bitarray) {
+        bench_bitarray<uint8_t>("uint8_t", bitarray_results);
+        bench_bitarray<uint16_t>("uint16_t", bitarray_results);
+        bench_bitarray<uint32_t>("uint32_t", bitarray_results);
+        bench_bitarray<uint64_t>("uint64_t", bitarray_results);
+
+        cout << endl << std::left << std::setw(12) << "cell" << std::setw(16) << "op" << std::right
+             << std::setw(10) << "ns/op" << endl;
+
+        for (const BitArrayResult& r : bitarray_results) {
+            cout << std::left << std::setw(12) << r.cell << std::setw(16) << r.op << std::right
+                 << std::fixed << std::setprecision(2) << std::setw(10) << r.ns_per_op << endl;
+        }
+    }
+
+    std::ofstream json(json_path);
+    write_json(json, synthetic_size, coding_results, bitarray_results);
+    cout << endl << "results written to " << json_path << endl;
+}
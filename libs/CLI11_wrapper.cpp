@@ -3,19 +3,112 @@
 // source: https://github.com/CLIUtils/CLI11
 #include "external/CLI11.hpp"
 
-int parse(int argc, char** argv, std::string& source_path, std::string& destination_path, bool& encode, bool& decode) {
+#include <map>
+
+namespace {
+
+// "offset:length" in bytes
+bool parse_range(const std::string& text, uint64_t& offset, uint64_t& length) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == text.size()) {
+        return false;
+    }
+
+    std::string offset_text = text.substr(0, colon);
+    std::string length_text = text.substr(colon + 1);
+    if (offset_text.find_first_not_of("0123456789") != std::string::npos ||
+        length_text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    try {
+        offset = std::stoull(offset_text);
+        length = std::stoull(length_text);
+    }
+    catch (const std::out_of_range&) {
+        return false;
+    }
+
+    return true;
+}
+
+} // end namespace
+
+int parse(int argc, char** argv, Options& options) {
 
     CLI::App app{"Adaptive Huffman coding compressor/decompressor"};
 
-    CLI::Option* pack = app.add_flag("-p,--pack", encode, "Pack/compress");
-    CLI::Option* unpack = app.add_flag("-u,--unpack", decode, "Unpack/decompress");
+    CLI::Option* pack = app.add_flag("-p,--pack", options.encode, "Pack/compress");
+    CLI::Option* unpack = app.add_flag("-u,--unpack", options.decode, "Unpack/decompress");
     pack->excludes(unpack);
     unpack->excludes(pack);
 
-    app.add_option("-s,--source", source_path, "Source/input file")->required();
-    app.add_option("-d,--destination", destination_path, "Destination/output file")->required();
+    app.add_option("-s,--source", options.source_path, "Source/input file");
+    app.add_option("-d,--destination", options.destination_path, "Destination/output file (dictionary when training)");
+
+    CLI::Option* train = app.add_option("--train", options.train_paths, "Train a dictionary from sample files (written to destination)")
+        ->check(CLI::ExistingFile);
+    train->excludes(pack);
+    train->excludes(unpack);
+    CLI::Option* batch = app.add_option("--batch", options.batch_paths, "Pack/unpack many files or directories at once into destination directory")
+        ->check(CLI::ExistingPath);
+    batch->excludes(train);
+    app.add_flag("--archive", options.archive, "Batch mode: single archive file (destination when packing, inputs when unpacking)")
+        ->needs(batch);
+    app.add_option("--dict", options.dictionary_path, "Start from a pre-trained dictionary (adaptive engine, takes its updater)")
+        ->check(CLI::ExistingFile)
+        ->excludes(train);
+
+    app.add_option("-t,--threads", options.threads, "Code independent chunks by N threads (0 = single stream)")
+        ->check(CLI::NonNegativeNumber);
+    app.add_option("--chunk-size", options.chunk_size, "Chunk size in bytes for chunked mode")
+        ->check(CLI::Range((size_t)1, (size_t)UINT32_MAX));
+
+    std::map<std::string, Mode> modes{{"adaptive", ADAPTIVE}, {"static", STATIC}, {"block", BLOCK}};
+    app.add_option("-m,--mode", options.mode, "Engine: adaptive tree, two-pass static code or per-block code (recorded in the header)")
+        ->transform(CLI::CheckedTransformer(modes, CLI::ignore_case));
+    app.add_option("--block-size", options.block_size, "Block size in bytes for block mode")
+        ->check(CLI::Range((size_t)1, (size_t)UINT32_MAX));
+
+    app.add_flag("--pipeline", options.pipeline, "Read, code and write on separate threads (single stream)");
+
+    app.add_flag("--seekable", options.seekable, "Independent frames with an index at the end (adaptive engine)");
+    std::string range;
+    app.add_option("--range", range, "Unpack only bytes offset:length of a seekable stream")
+        ->check([](const std::string& value) {
+            uint64_t offset, length;
+            return parse_range(value, offset, length) ? std::string() : std::string("expected offset:length");
+        })
+        ->needs(unpack);
+
+    std::map<std::string, detail::Updater> updaters{{"fgk", detail::FGK}, {"vitter", detail::VITTER}};
+    app.add_option("--updater", options.updater, "Tree update algorithm (recorded in the header)")
+        ->transform(CLI::CheckedTransformer(updaters, CLI::ignore_case));
+
+    app.add_flag("--aging", options.aging, "Halve tree counts periodically to follow changing data (recorded in the header)");
+
+    app.add_option("--checkpoints", options.checkpoints, "Model snapshot every N MiB of a single adaptive stream (unpacking with --threads decodes in parallel)")
+        ->check(CLI::NonNegativeNumber);
+
+    app.add_flag("--append", options.append, "Continue an appendable destination with the source (created if missing), only the new data are coded")
+        ->needs(pack);
+
+    app.add_option("--flush-bytes", options.flush_bytes, "Flush the output every N bytes of input (short frame, the model carries over)")
+        ->check(CLI::NonNegativeNumber)
+        ->needs(pack);
+
+    app.add_option("--flush-ms", options.flush_ms, "Flush the output N ms after the oldest unflushed byte (slow producers on a pipe)")
+        ->check(CLI::NonNegativeNumber)
+        ->needs(pack);
+
+    app.add_flag("--stats", options.stats, "Print coding statistics as JSON to stderr (counters need make STATS=1)");
 
     CLI11_PARSE(app, argc, argv);
 
+    options.range = !range.empty();
+    if (options.range) {
+        parse_range(range, options.range_offset, options.range_length);
+    }
+
     return 0;
 }
@@ -1,5 +1,62 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
-int parse(int argc, char** argv, std::string& source_path, std::string& destination_path, bool& encode, bool& decode);
+#include "huffnode.hpp"
+
+enum Mode { ADAPTIVE, STATIC, BLOCK };
+
+struct Options {
+    std::string source_path;
+    std::string destination_path;
+    bool encode = false;
+    bool decode = false;
+
+    // 0 means classic single stream, >0 independent chunks
+    // (batch mode: workers, 0 = one per core)
+    unsigned int threads = 0;
+    size_t chunk_size = 4 << 20;
+
+    // engine used for packing, unpacking takes it from the header
+    Mode mode = ADAPTIVE;
+    // block engine: bytes per canonical table (threads code blocks in parallel)
+    size_t block_size = 128 << 10;
+
+    // single stream: read, code and write on separate threads
+    bool pipeline = false;
+
+    // independent frames with an index, unpacking can decode a range only
+    bool seekable = false;
+    bool range = false;
+    uint64_t range_offset = 0;
+    uint64_t range_length = 0;
+
+    // tree update algorithm, unpacking takes it from the header
+    detail::Updater updater = detail::FGK;
+    // halve counts periodically (recorded in the header)
+    bool aging = false;
+    // model snapshot every N MiB (frames) of a single stream, 0 = none
+    size_t checkpoints = 0;
+    // destination is continued (with only the new data coded) or created appendable
+    bool append = false;
+    // flush points every N bytes of input / N ms after the oldest unflushed byte, 0 = none
+    size_t flush_bytes = 0;
+    int flush_ms = 0;
+
+    // many files (or directories) at once, destination is a directory
+    // or the archive (when packing)
+    std::vector<std::string> batch_paths;
+    bool archive = false;
+
+    // sample files, dictionary is written to destination_path
+    std::vector<std::string> train_paths;
+    // pre-trained model (adaptive engine), unpacking needs the same one
+    std::string dictionary_path;
+
+    // counters as JSON on stderr (collected only in STATS=1 builds)
+    bool stats = false;
+};
+
+int parse(int argc, char** argv, Options& options);
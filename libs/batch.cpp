@@ -0,0 +1,537 @@
+#include "batch.hpp"
+
+#include "huffman.hpp"
+#include "static_huffman.hpp"
+#include "block_huffman.hpp"
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+using namespace std::chrono;
+using namespace detail;
+
+namespace fs = std::filesystem;
+
+namespace hf {
+
+namespace {
+
+const char ARCHIVE_MAGIC[4] = { 'H', 'U', 'F', 'A' };
+const uint8_t ARCHIVE_VERSION = 1;
+const size_t ARCHIVE_HEADER_SIZE = 5;
+
+const std::string SUFFIX = ".huf";
+
+struct Input {
+    std::string path;
+    std::string name;
+};
+
+// files of the inputs, names relative to the directory given
+std::vector<Input> collect(const std::vector<std::string>& inputs) {
+    std::vector<Input> files;
+
+    for (const std::string& input : inputs) {
+        if (!fs::is_directory(input)) {
+            files.push_back({ input, fs::path(input).filename().string() });
+            continue;
+        }
+
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input)) {
+            if (entry.is_regular_file()) {
+                files.push_back({ entry.path().string(), fs::relative(entry.path(), input).generic_string() });
+            }
+        }
+    }
+
+    // outputs would overwrite each other
+    std::set<std::string> names;
+    for (const Input& file : files) {
+        if (!names.insert(file.name).second) {
+            throw std::runtime_error("duplicate name in batch: " + file.name);
+        }
+    }
+
+    return files;
+}
+
+void check_name(const std::string& name) {
+    fs::path path(name);
+    bool bad = name.empty() || path.is_absolute();
+    for (const fs::path& part : path) {
+        bad |= part == "..";
+    }
+
+    if (bad) {
+        throw std::runtime_error("invalid name in archive: " + name);
+    }
+}
+
+void put_le(char* out, uint64_t value, int bytes) {
+    for (int i=0; i<bytes; i++) {
+        out[i] = (char)(value >> (8 * i));
+    }
+}
+
+uint64_t get_le(const char* in, int bytes) {
+    uint64_t value = 0;
+    for (int i=0; i<bytes; i++) {
+        value |= (uint64_t)(uint8_t)in[i] << (8 * i);
+    }
+
+    return value;
+}
+
+} // end namespace
+
+
+// frame API only, the streams aren't used
+struct Batch::Worker {
+    io::MemorySource no_source;
+    std::string no_output;
+    io::StringSink no_sink;
+
+    Huffman coder;
+
+    Worker() : no_source(nullptr, 0), no_sink(no_output), coder(no_source, no_sink) {
+        coder.set_verbose(false);
+    }
+
+    void reset(Updater updater, const Dictionary* dictionary, bool aging) {
+        coder.set_updater(updater);
+        coder.set_dictionary(dictionary);
+        coder.set_aging(aging);
+        coder.reset_model();
+    }
+};
+
+struct Batch::PackedFile {
+    std::string name;
+    std::unique_ptr<io::Source> source;
+
+    struct Chunk {
+        const char* data = nullptr;
+        size_t size = 0;
+        std::string storage;
+
+        std::string packed;
+        uint32_t checksum = 0;
+    };
+
+    // deque, chunks don't move (data may point into storage)
+    std::deque<Chunk> chunks;
+    uint64_t length = 0;
+    std::atomic<size_t> remaining{0};
+};
+
+// whole input, points into the mapping if there is one
+struct Batch::Loaded {
+    std::unique_ptr<io::Source> source;
+    std::string storage;
+
+    const char* data = nullptr;
+    size_t size = 0;
+
+    Loaded(const std::string& path) : source(new io::FileSource(path)) {
+        if (source->remaining() != io::UNKNOWN_SIZE) {
+            size = source->read(data, source->remaining(), storage);
+            return;
+        }
+
+        std::string part;
+        const char* part_data;
+        size_t part_size;
+        while ((part_size = source->read(part_data, 1 << 20, part)) > 0) {
+            storage.append(part_data, part_size);
+        }
+
+        data = storage.data();
+        size = storage.size();
+    }
+};
+
+struct Batch::UnpackedFile {
+    std::string name;
+    // keeps the packed data alive
+    std::shared_ptr<Loaded> packed;
+
+    container::Header header;
+    std::deque<container::Frame> frames;
+    std::string raw;
+    uint64_t packed_size = 0;
+    std::atomic<size_t> remaining{0};
+};
+
+
+Batch::Batch(unsigned int threads, size_t chunk_size) : chunk_size_(chunk_size),
+                                                        pool_(threads ? threads : std::thread::hardware_concurrency()) {
+    if (chunk_size_ == 0 || chunk_size_ > UINT32_MAX) {
+        throw std::invalid_argument("invalid chunk size");
+    }
+
+    for (unsigned int i=0; i<pool_.size(); i++) {
+        workers_.emplace_back(new Worker());
+    }
+}
+
+Batch::~Batch() = default;
+
+void Batch::timer_start() {
+    start_ = steady_clock::now();
+}
+
+void Batch::timer_stop() {
+    end_ = steady_clock::now();
+}
+
+void Batch::print_stats() {
+    if (!verbose_) {
+        return;
+    }
+
+    auto duration = duration_cast<microseconds>(end_ - start_);
+    cout << "files " << files_ << " chunks " << chunks_ << " threads " << pool_.size() << endl;
+    cout << "bytes input " << input_bytes_ << " output " << output_bytes_ << endl;
+    cout << "took " << std::fixed << duration.count() / 1000000. << "s" << endl;
+}
+
+void Batch::deliver(const std::string& name, const std::string& data, uint64_t input_size) {
+    if (archive_) {
+        char header[2];
+        char size[8];
+        put_le(header, name.size(), 2);
+        put_le(size, data.size(), 8);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        archive_->write(header, 2);
+        archive_->write(name.data(), name.size());
+        archive_->write(size, 8);
+        archive_->write(data.data(), data.size());
+
+        files_++;
+        input_bytes_ += input_size;
+        output_bytes_ += 2 + name.size() + 8 + data.size();
+        return;
+    }
+
+    fs::path path = fs::path(dest_) / name;
+    fs::create_directories(path.parent_path());
+
+    io::FileSink sink(path.string());
+    sink.write(data.data(), data.size());
+    sink.flush();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_++;
+    input_bytes_ += input_size;
+    output_bytes_ += data.size();
+}
+
+
+void Batch::pack_file(const std::string& path, const std::string& name, unsigned int worker) {
+    std::shared_ptr<PackedFile> file(new PackedFile());
+    file->name = name;
+    file->source.reset(new io::FileSource(path));
+
+    while (true) {
+        PackedFile::Chunk& chunk = file->chunks.emplace_back();
+        chunk.size = file->source->read(chunk.data, chunk_size_, chunk.storage);
+        file->length += chunk.size;
+
+        if (chunk.size < chunk_size_) {
+            if (chunk.size == 0) {
+                file->chunks.pop_back();
+            }
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunks_ += file->chunks.size();
+    }
+
+    if (file->chunks.size() <= 1) {
+        if (!file->chunks.empty()) {
+            encode_chunk(*file, 0, worker);
+        }
+        finish_packed(*file);
+        return;
+    }
+
+    // the rest is left to this worker (or stolen by idle ones)
+    file->remaining = file->chunks.size();
+    for (size_t i=0; i<file->chunks.size(); i++) {
+        pool_.submit([this, file, i](unsigned int worker) {
+            encode_chunk(*file, i, worker);
+            if (--file->remaining == 0) {
+                finish_packed(*file);
+            }
+        });
+    }
+}
+
+void Batch::encode_chunk(PackedFile& file, size_t chunk, unsigned int worker) {
+    PackedFile::Chunk& c = file.chunks[chunk];
+    Worker& w = *workers_[worker];
+
+    w.reset(dictionary_ ? dictionary_->get_updater() : updater_, dictionary_, aging_);
+    w.coder.encode_frame(c.data, c.size, c.packed);
+    c.checksum = container::adler32(c.data, c.size);
+}
+
+void Batch::finish_packed(PackedFile& file) {
+    Updater updater = dictionary_ ? dictionary_->get_updater() : updater_;
+
+    container::Header header;
+    header.flags = (updater == VITTER ? container::FLAG_VITTER : 0) | container::FLAG_INDEPENDENT |
+                   (dictionary_ ? container::FLAG_DICTIONARY : 0) |
+                   (aging_ ? container::FLAG_AGING : 0);
+    header.frame_size = chunk_size_;
+    header.length = file.length;
+    header.dictionary_id = dictionary_ ? dictionary_->get_id() : 0;
+
+    std::string stream;
+    io::StringSink sink(stream);
+    container::write_header(sink, header);
+    for (PackedFile::Chunk& chunk : file.chunks) {
+        container::write_frame(sink, chunk.size, chunk.packed, chunk.checksum);
+        chunk.packed = std::string();
+    }
+
+    deliver(archive_ ? file.name : file.name + SUFFIX, stream, file.length);
+    file.source.reset();
+}
+
+void Batch::encode(const std::vector<std::string>& inputs, const std::string& dest, bool archive) {
+
+    timer_start();
+
+    std::vector<Input> files = collect(inputs);
+
+    dest_ = dest;
+    if (archive) {
+        archive_.reset(new io::FileSink(dest));
+
+        char header[ARCHIVE_HEADER_SIZE];
+        std::copy(ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4, header);
+        header[4] = ARCHIVE_VERSION;
+        archive_->write(header, ARCHIVE_HEADER_SIZE);
+        output_bytes_ += ARCHIVE_HEADER_SIZE;
+    }
+    else {
+        fs::create_directories(dest);
+    }
+
+    for (const Input& input : files) {
+        pool_.submit([this, input](unsigned int worker) { pack_file(input.path, input.name, worker); });
+    }
+    pool_.wait();
+
+    if (archive_) {
+        char end[2] = { 0, 0 };
+        archive_->write(end, 2);
+        archive_->flush();
+        output_bytes_ += 2;
+        archive_.reset();
+    }
+
+    timer_stop();
+    print_stats();
+}
+
+
+void Batch::unpack_file(const std::string& path, const std::string& name) {
+    std::shared_ptr<Loaded> packed(new Loaded(path));
+    unpack_stream(packed, packed->data, packed->size, name);
+}
+
+void Batch::unpack_stream(std::shared_ptr<Loaded> packed, const char* data, size_t size, const std::string& name) {
+    io::MemorySource source(data, size);
+
+    std::shared_ptr<UnpackedFile> file(new UnpackedFile());
+    file->name = name;
+    file->packed = packed;
+    file->header = container::read_header(source);
+    file->packed_size = size;
+
+    const container::Header& header = file->header;
+    check_dictionary(header, dictionary_);
+
+    bool independent = header.get_engine() == container::ENGINE_ADAPTIVE
+                    && (header.flags & container::FLAG_INDEPENDENT)
+                    && header.length != container::UNKNOWN_LENGTH;
+
+    if (!independent) {
+        // frames depend on each other, the whole stream on this worker
+        io::StringSink sink(file->raw);
+        if (header.get_engine() == container::ENGINE_STATIC) {
+            StaticHuffman coder(source, sink);
+            coder.set_verbose(false);
+            coder.decode(header);
+        }
+        else if (header.get_engine() == container::ENGINE_BLOCK) {
+            BlockHuffman coder(source, sink);
+            coder.set_verbose(false);
+            coder.decode(header);
+        }
+        else {
+            Huffman coder(source, sink);
+            coder.set_verbose(false);
+            coder.set_dictionary(dictionary_);
+            coder.decode(header);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            chunks_++;
+        }
+        finish_unpacked(*file);
+        return;
+    }
+
+    uint64_t raw_read = 0;
+    container::Frame frame;
+    while (container::read_next_frame(source, header, frame, raw_read)) {
+        // every byte takes at least a bit, checked before allocating the output
+        if (frame.raw_size > (uint64_t)frame.packed_size * 8) {
+            throw std::runtime_error("corrupt frame header");
+        }
+
+        file->frames.push_back(frame);
+    }
+    file->raw.resize(header.length);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunks_ += file->frames.size();
+    }
+
+    if (file->frames.empty()) {
+        finish_unpacked(*file);
+        return;
+    }
+
+    file->remaining = file->frames.size();
+    for (size_t i=0; i<file->frames.size(); i++) {
+        pool_.submit([this, file, i](unsigned int worker) {
+            decode_frame(*file, i, worker);
+            if (--file->remaining == 0) {
+                finish_unpacked(*file);
+            }
+        });
+    }
+}
+
+void Batch::decode_frame(UnpackedFile& file, size_t frame, unsigned int worker) {
+    const container::Frame& f = file.frames[frame];
+    const container::Header& header = file.header;
+    Worker& w = *workers_[worker];
+
+    bool dictionary = header.flags & container::FLAG_DICTIONARY;
+    w.reset(header.flags & container::FLAG_VITTER ? VITTER : FGK, dictionary ? dictionary_ : nullptr,
+            header.flags & container::FLAG_AGING);
+
+    char* raw = &file.raw[frame * (size_t)header.frame_size];
+    w.coder.decode_frame(f.packed, f.packed_size, raw, f.raw_size);
+    container::check_frame(f, raw, f.raw_size);
+}
+
+void Batch::finish_unpacked(UnpackedFile& file) {
+    deliver(file.name, file.raw, file.packed_size);
+    file.raw = std::string();
+    file.packed.reset();
+}
+
+void Batch::decode(const std::vector<std::string>& inputs, const std::string& dest, bool archive) {
+
+    timer_start();
+
+    std::vector<Input> files = collect(inputs);
+
+    dest_ = dest;
+    fs::create_directories(dest);
+
+    if (!archive) {
+        for (Input& input : files) {
+            size_t stem = input.name.size() - SUFFIX.size();
+            if (input.name.size() <= SUFFIX.size() || input.name.compare(stem, SUFFIX.size(), SUFFIX) != 0) {
+                throw std::runtime_error("unknown suffix (expected " + SUFFIX + "): " + input.path);
+            }
+
+            input.name.resize(stem);
+            pool_.submit([this, input](unsigned int) { unpack_file(input.path, input.name); });
+        }
+
+        pool_.wait();
+
+        timer_stop();
+        print_stats();
+        return;
+    }
+
+    std::set<std::string> names;
+    for (const Input& input : files) {
+        std::shared_ptr<Loaded> packed(new Loaded(input.path));
+        const char* data = packed->data;
+        size_t size = packed->size;
+
+        if (size < ARCHIVE_HEADER_SIZE || !std::equal(ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4, data)) {
+            throw std::runtime_error("not a batch archive: " + input.path);
+        }
+        if ((uint8_t)data[4] != ARCHIVE_VERSION) {
+            throw std::runtime_error("unsupported archive version: " + input.path);
+        }
+
+        size_t pos = ARCHIVE_HEADER_SIZE;
+        while (true) {
+            if (size - pos < 2) {
+                throw std::runtime_error("truncated archive: " + input.path);
+            }
+
+            size_t name_size = get_le(data + pos, 2);
+            pos += 2;
+            if (name_size == 0) {
+                break;
+            }
+
+            if (size - pos < name_size + 8) {
+                throw std::runtime_error("truncated archive: " + input.path);
+            }
+
+            std::string name(data + pos, name_size);
+            check_name(name);
+            if (!names.insert(name).second) {
+                throw std::runtime_error("duplicate name in archive: " + name);
+            }
+            pos += name_size;
+
+            uint64_t stream_size = get_le(data + pos, 8);
+            pos += 8;
+            if (size - pos < stream_size) {
+                throw std::runtime_error("truncated archive: " + input.path);
+            }
+
+            const char* stream = data + pos;
+            pos += stream_size;
+
+            pool_.submit([this, packed, stream, stream_size, name](unsigned int) {
+                unpack_stream(packed, stream, stream_size, name);
+            });
+        }
+    }
+
+    pool_.wait();
+
+    timer_stop();
+    print_stats();
+}
+
+} // end namespace
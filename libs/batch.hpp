@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include <chrono>
+
+#include "huffnode.hpp"
+#include "container.hpp"
+#include "dictionary.hpp"
+#include "thread_pool.hpp"
+#include "io.hpp"
+
+namespace hf {
+
+/*
+ * Batch mode (--batch)
+ * Many files (directories are walked recursively) are coded in one process
+ * on a work-stealing pool. Every file is a job, files larger than the chunk
+ * size split into chunk jobs (independent frames, like chunked mode), so
+ * one big file doesn't keep the other workers idle. Every worker keeps its
+ * own coder, warm across jobs. Outputs are separate streams (name.huf, plain
+ * --unpack reads them) or a single archive:
+ *
+ *   archive: magic "HUFA", version u8,
+ *            entries: name_size u16, name, stream_size u64, stream,
+ *            name_size 0 ends the archive
+ *
+ * Entries are stored in the order they finish. Names are relative paths
+ * ('/' separated), unpacking refuses absolute ones and "..".
+ */
+class Batch {
+
+    struct Worker;
+    struct Loaded;
+    struct PackedFile;
+    struct UnpackedFile;
+
+    size_t chunk_size_;
+    detail::Updater updater_ = detail::FGK;
+    const Dictionary* dictionary_ = nullptr;
+    bool aging_ = false;
+    bool verbose_ = true;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    // where outputs go (archive only when packing into one)
+    std::string dest_;
+    std::unique_ptr<io::FileSink> archive_;
+
+    std::mutex mutex_;
+    size_t files_ = 0;
+    size_t chunks_ = 0;
+    uint64_t input_bytes_ = 0;
+    uint64_t output_bytes_ = 0;
+
+    std::chrono::time_point<std::chrono::steady_clock> start_, end_;
+    void timer_start();
+    void timer_stop();
+    void print_stats();
+
+    void pack_file(const std::string& path, const std::string& name, unsigned int worker);
+    void encode_chunk(PackedFile& file, size_t chunk, unsigned int worker);
+    void finish_packed(PackedFile& file);
+
+    void unpack_file(const std::string& path, const std::string& name);
+    void unpack_stream(std::shared_ptr<Loaded> packed, const char* data, size_t size, const std::string& name);
+    void decode_frame(UnpackedFile& file, size_t frame, unsigned int worker);
+    void finish_unpacked(UnpackedFile& file);
+
+    // separate file in dest_ or archive entry
+    void deliver(const std::string& name, const std::string& data, uint64_t input_size);
+
+    // last, so workers stop before the state they use goes away
+    detail::ThreadPool pool_;
+
+public:
+    Batch(unsigned int threads, size_t chunk_size);
+    ~Batch();
+
+    void set_updater(detail::Updater updater) { updater_ = updater; }
+    // see Huffman::set_dictionary
+    void set_dictionary(const Dictionary* dictionary) { dictionary_ = dictionary; }
+    void set_aging(bool enabled) { aging_ = enabled; }
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+
+    /*
+     * Inputs are files or directories, dest is the output directory
+     * or the archive file. Throws the first error of a job.
+     */
+    void encode(const std::vector<std::string>& inputs, const std::string& dest, bool archive);
+    // inputs are .huf files (or directories of them) or archives
+    void decode(const std::vector<std::string>& inputs, const std::string& dest, bool archive);
+};
+
+} // end namespace
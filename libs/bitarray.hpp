@@ -55,6 +55,7 @@ public:
     size_t get_last_cell_bits() const;
     size_t get_last_cell_free_bits() const { return bits_per_cell_ - get_last_cell_bits(); }
     size_t get_bits_left() const { return (cells_.size() * bits_per_cell_) - bits_used_; }
+    Cell get_cell(size_t i) const { return cells_[i]; }
     
     void grow_to_atleast(size_t min_cells);
     
@@ -97,6 +98,14 @@ public:
     uint8_t trim_byte();
     uint8_t trim_bit();
     
+    /*
+     * Peek/drop bits
+     * Look at leftmost n bits (n <= bits per cell) without removing them,
+     * then remove any number of them
+     */
+    Cell peek_bits(size_t n) const;
+    void drop_bits(size_t n) { bits_used_ -= n; }
+    
     /*
      * Load byte from right side
      */
@@ -466,6 +475,25 @@ uint8_t BitArray<Cell>::trim_bit() {
     return (cells_[N-1] & mask) ? 1 : 0;
 }
 
+template<typename Cell>
+Cell BitArray<Cell>::peek_bits(size_t n) const {
+    size_t first = bits_used_ - n;
+    size_t index = first / bits_per_cell_;
+    size_t offset = first % bits_per_cell_;
+    
+    Cell result = cells_[index] >> offset;
+    if (offset + n > bits_per_cell_) {
+        // bits cross cell border
+        result |= cells_[index + 1] << (bits_per_cell_ - offset);
+    }
+    
+    if (n < bits_per_cell_) {
+        result &= ((Cell)1 << n) - 1;
+    }
+    
+    return result;
+}
+
 /*
  * Used to load bits from the left side of the BitArray
  */
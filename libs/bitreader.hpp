@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace bitarr {
+
+/*
+ * Reads bits (most significant first) from a byte span.
+ * Bits are kept left-aligned in a 64-bit accumulator, refill()
+ * tops it up to at least 57 bits. While 8 bytes of the span remain
+ * it loads a whole word and takes as many bytes as fit (bits below
+ * acc_bits_ are then valid bits of the next byte, loading them
+ * again changes nothing), the last 7 bytes go one by one.
+ * Past the end of the span zeros are read, overrun() tells
+ * if any of them were consumed.
+ */
+class BitReader {
+
+    const uint8_t* pos_;
+    const uint8_t* end_;
+
+    uint64_t acc_ = 0;
+    size_t acc_bits_ = 0;
+    // zero bits appended past the end (always the last ones in acc_)
+    size_t padding_bits_ = 0;
+
+    void refill_tail();
+
+public:
+    BitReader(const char* data, size_t size) : pos_((const uint8_t*)data), end_((const uint8_t*)data + size) { }
+
+    void refill();
+
+    // n (1..57) next bits, refill() first
+    uint64_t peek(size_t n) const { return acc_ >> (64 - n); }
+    void consume(size_t n) { acc_ <<= n; acc_bits_ -= n; }
+
+    bool overrun() const { return acc_bits_ < padding_bits_; }
+    // bits of the span not consumed yet
+    size_t get_bits_left() const { return (end_ - pos_) * 8 + acc_bits_ - padding_bits_; }
+};
+
+/*
+ * Implementations
+ */
+
+inline void BitReader::refill() {
+    if (acc_bits_ > 56) {
+        return;
+    }
+
+    if (end_ - pos_ < 8) {
+        refill_tail();
+        return;
+    }
+
+    uint64_t word;
+    std::memcpy(&word, pos_, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    acc_ |= word >> acc_bits_;
+
+    size_t bytes = (64 - acc_bits_) >> 3;
+    pos_ += bytes;
+    acc_bits_ += bytes * 8;
+}
+
+inline void BitReader::refill_tail() {
+    while (acc_bits_ <= 56) {
+        uint64_t byte = 0;
+        if (pos_ < end_) {
+            byte = *pos_++;
+        }
+        else {
+            padding_bits_ += 8;
+        }
+
+        acc_ |= byte << (56 - acc_bits_);
+        acc_bits_ += 8;
+    }
+}
+
+} // end namespace
@@ -0,0 +1,32 @@
+#include "bitwriter.hpp"
+
+namespace bitarr {
+
+BitWriter::BitWriter(std::ostream& dest) : dest_(dest), block_(block_size_) { }
+
+void BitWriter::flush_block() {
+    dest_.write((const char*)block_.data(), block_used_);
+
+    bytes_written_ += block_used_;
+    block_used_ = 0;
+}
+
+void BitWriter::finish() {
+    if (acc_bits_ % 8) {
+        put_bits(0, 8 - acc_bits_ % 8);
+    }
+
+    // whole bytes left in accumulator
+    if (block_used_ + acc_bits_ / 8 > block_size_) {
+        flush_block();
+    }
+
+    while (acc_bits_) {
+        acc_bits_ -= 8;
+        block_[block_used_++] = acc_ >> acc_bits_;
+    }
+
+    flush_block();
+}
+
+} // end namespace
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <ostream>
+
+#include "bitarray.hpp"
+
+namespace bitarr {
+
+/*
+ * Streaming bit writer
+ * Bits are collected in a 64-bit accumulator, whole words go
+ * to the output block, which is written to the stream when full.
+ * Produces the same bitstream as appending to BitArray and
+ * trimming cells/bytes from it (most significant bit first).
+ */
+class BitWriter {
+
+    static const size_t block_size_ = 1 << 16;
+
+    std::ostream& dest_;
+
+    // only acc_bits_ lowest bits are meaningful
+    uint64_t acc_ = 0;
+    size_t acc_bits_ = 0;
+
+    std::vector<uint8_t> block_;
+    size_t block_used_ = 0;
+    size_t bytes_written_ = 0;
+
+    void put_word(uint64_t word);
+    void flush_block();
+
+    template<typename Array>
+    void put_cells(const Array& bits, size_t bits_per_cell);
+
+public:
+    BitWriter(std::ostream& dest);
+
+    /*
+     * Append len (<= 64) lowest bits of code,
+     * bits above len have to be zero
+     */
+    void put_bits(uint64_t code, size_t len);
+
+    template<typename Cell>
+    void put_bits(const BitArray<Cell>& bits) { put_cells(bits, sizeof(Cell) * 8); }
+
+    /*
+     * Pad to full byte with zeros and write everything to the stream
+     */
+    void finish();
+
+    size_t get_bytes_written() const { return bytes_written_ + block_used_; }
+};
+
+
+/*
+ * Implementations
+ */
+
+inline void BitWriter::put_word(uint64_t word) {
+    if (block_used_ + sizeof(word) > block_size_) {
+        flush_block();
+    }
+
+    uint8_t* out = &block_[block_used_];
+    for (unsigned int i=0; i<sizeof(word); i++) {
+        out[i] = word >> 8*(sizeof(word)-i-1);
+    }
+
+    block_used_ += sizeof(word);
+}
+
+inline void BitWriter::put_bits(uint64_t code, size_t len) {
+    if (acc_bits_ + len < 64) {
+        acc_ = (acc_ << len) | code;
+        acc_bits_ += len;
+        return;
+    }
+
+    // accumulator full, bits that don't fit stay in acc_
+    size_t rest = acc_bits_ + len - 64;
+    uint64_t word = acc_bits_ ? (acc_ << (64 - acc_bits_)) | (code >> rest) : code;
+
+    put_word(word);
+
+    acc_ = code;
+    acc_bits_ = rest;
+}
+
+/*
+ * Writes (Fixed)BitArray cell by cell, starting from the most significant
+ */
+template<typename Array>
+void BitWriter::put_cells(const Array& bits, size_t bits_per_cell) {
+    size_t N = bits.get_cells_used();
+    if (N == 0) {
+        return;
+    }
+
+    // last cell may hold stale bits above the used ones
+    size_t last_bits = bits.get_last_cell_bits();
+    uint64_t last = bits.get_cell(N-1);
+    if (last_bits < 64) {
+        last &= ((uint64_t)1 << last_bits) - 1;
+    }
+
+    put_bits(last, last_bits);
+    for (int i=N-2; i>=0; i--) {
+        put_bits(bits.get_cell(i), bits_per_cell);
+    }
+}
+
+} // end namespace
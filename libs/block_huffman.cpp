@@ -0,0 +1,450 @@
+#include "block_huffman.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "parallel.hpp"
+#include "stats.hpp"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+using namespace std::chrono;
+using namespace detail;
+
+namespace detail {
+
+namespace {
+
+const int LENGTH_BITS = 4;
+const int RUN_BITS = 4;
+const int MAX_RUN = 1 << RUN_BITS;
+
+// zero lengths starting at symbol (at most MAX_RUN)
+int zero_run(const CodeLengths lengths, int symbol) {
+    int run = 1;
+    while (run < MAX_RUN && symbol + run < N_SYMBOLS && lengths[symbol + run] == 0) {
+        run++;
+    }
+
+    return run;
+}
+
+} // end namespace
+
+void write_table(bitarr::BitWriter& writer, const CodeLengths lengths) {
+    writer.put_bits(0, 1);
+
+    for (int s=0; s<N_SYMBOLS; ) {
+        writer.put_bits(lengths[s], LENGTH_BITS);
+        if (lengths[s] != 0) {
+            s++;
+            continue;
+        }
+
+        int run = zero_run(lengths, s);
+        writer.put_bits(run - 1, RUN_BITS);
+        s += run;
+    }
+}
+
+void write_reuse(bitarr::BitWriter& writer) {
+    writer.put_bits(1, 1);
+}
+
+uint64_t table_bits(const CodeLengths lengths) {
+    uint64_t bits = 1;
+
+    for (int s=0; s<N_SYMBOLS; ) {
+        bits += LENGTH_BITS;
+        if (lengths[s] != 0) {
+            s++;
+            continue;
+        }
+
+        bits += RUN_BITS;
+        s += zero_run(lengths, s);
+    }
+
+    return bits;
+}
+
+bool read_table(bitarr::BitReader& reader, CodeLengths lengths) {
+    reader.refill();
+    bool reuse = reader.peek(1);
+    reader.consume(1);
+
+    for (int s=0; !reuse && s<N_SYMBOLS; ) {
+        reader.refill();
+        int length = reader.peek(LENGTH_BITS);
+        reader.consume(LENGTH_BITS);
+
+        if (length != 0) {
+            lengths[s++] = length;
+            continue;
+        }
+
+        int run = reader.peek(RUN_BITS) + 1;
+        reader.consume(RUN_BITS);
+        if (s + run > N_SYMBOLS) {
+            throw std::runtime_error("corrupt block table");
+        }
+
+        for (int i=0; i<run; i++) {
+            lengths[s++] = 0;
+        }
+    }
+
+    // padding has to be zero
+    reader.refill();
+    size_t padding = reader.get_bits_left() % 8;
+    if (reader.overrun() || (padding && reader.peek(padding) != 0)) {
+        throw std::runtime_error("corrupt block table");
+    }
+    reader.consume(padding);
+
+    return reuse;
+}
+
+} // namespace end
+
+
+namespace hf {
+
+namespace {
+
+struct Block {
+    // raw data points into the source (if mapped) or into storage
+    const char* data = nullptr;
+    size_t size = 0;
+    std::string storage;
+
+    Histogram histogram;
+    CodeLengths lengths;
+    bool reuse = false;
+
+    std::string packed;
+    uint32_t checksum = 0;
+};
+
+// every byte present in the block has a code
+bool covers(const Histogram histogram, const CodeLengths lengths) {
+    for (int s=0; s<N_SYMBOLS; s++) {
+        if (histogram[s] && !lengths[s]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void copy_lengths(const CodeLengths from, CodeLengths to) {
+    std::copy(from, from + N_SYMBOLS, to);
+}
+
+void encode_block(Block& block) {
+    block.packed.clear();
+
+    io::StringBuf buf;
+    buf.set_target(&block.packed);
+    std::ostream packed(&buf);
+    bitarr::BitWriter writer(packed);
+
+    if (block.reuse) {
+        write_reuse(writer);
+    }
+    else {
+        write_table(writer, block.lengths);
+    }
+    writer.finish();
+
+    CanonicalEncoder encoder;
+    encoder.build(block.lengths);
+
+    const uint8_t* bytes = (const uint8_t*)block.data;
+    for (size_t i=0; i<block.size; i++) {
+        writer.put_bits(encoder.bits[bytes[i]], encoder.length[bytes[i]]);
+        HF_STAT_ADD(code_lengths[encoder.length[bytes[i]]], 1);
+        HF_STAT_MAX(max_code_length, encoder.length[bytes[i]]);
+        HF_STAT_ADD(bits, encoder.length[bytes[i]]);
+    }
+
+    HF_STAT_ADD(symbols, block.size);
+
+    writer.finish();
+    packed.flush();
+}
+
+// frame with the table already parsed
+struct PackedBlock {
+    container::Frame frame;
+    CodeLengths lengths;
+    size_t codes_offset = 0;
+
+    std::string raw;
+};
+
+void decode_block(PackedBlock& block) {
+    const container::Frame& frame = block.frame;
+
+    CanonicalDecoder decoder;
+    decoder.build(block.lengths);
+
+    HF_STAT_ADD(symbols, frame.raw_size);
+    HF_STAT_ADD(bits, frame.packed_size * 8);
+
+    block.raw.resize(frame.raw_size);
+    bitarr::BitReader reader(frame.packed + block.codes_offset, frame.packed_size - block.codes_offset);
+    for (size_t i=0; i<block.raw.size(); i++) {
+        block.raw[i] = decoder.decode(reader);
+    }
+
+    // only padding may be left
+    if (reader.overrun() || reader.get_bits_left() >= 8) {
+        throw std::runtime_error("corrupt frame (bits left)");
+    }
+
+    container::check_frame(frame, block.raw.data(), block.raw.size());
+}
+
+} // end namespace
+
+
+BlockHuffman::BlockHuffman(io::Source& src, io::Sink& dest) : src_(src), dest_(dest),
+                                                             input_bytes(0), output_bytes(0),
+                                                             blocks(0), blocks_reused(0) { }
+
+BlockHuffman::BlockHuffman(std::istream& src, std::ostream& dest) : own_src_(new io::StreamSource(src)),
+                                                                   own_dest_(new io::StreamSink(dest)),
+                                                                   src_(*own_src_), dest_(*own_dest_),
+                                                                   input_bytes(0), output_bytes(0),
+                                                                   blocks(0), blocks_reused(0) { }
+
+void BlockHuffman::update_progress(uint64_t bytes_processed) {
+    if (progress_printer_) {
+        progress_printer_->progress_update(bytes_processed);
+    }
+}
+
+void BlockHuffman::finish_progress() {
+    if (progress_printer_) {
+        progress_printer_->finish();
+    }
+}
+
+void BlockHuffman::timer_start() {
+    start_ = steady_clock::now();
+}
+
+void BlockHuffman::timer_stop() {
+    end_ = steady_clock::now();
+}
+
+void BlockHuffman::timer_print() {
+    auto duration = duration_cast<microseconds>(end_ - start_);
+    cout << "took " << std::fixed << duration.count() / 1000000. << "s" << endl;
+}
+
+void BlockHuffman::print_stats() {
+    if (!verbose_) {
+        return;
+    }
+
+    cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
+    cout << "blocks " << blocks << " reused tables " << blocks_reused << endl;
+    timer_print();
+}
+
+
+void BlockHuffman::encode() {
+
+    timer_start();
+
+    uint64_t length = src_.remaining();
+
+    container::Header header;
+    header.flags = container::ENGINE_BLOCK;
+    header.frame_size = block_size_;
+    header.length = length;
+
+    container::write_header(dest_, header);
+    output_bytes += container::HEADER_SIZE;
+
+    std::vector<Block> batch(threads_);
+    CodeLengths previous = { };
+    bool has_previous = false;
+    bool end = false;
+
+    while (!end) {
+        size_t n = 0;
+        {
+            HF_STAT_TIME(io_ns);
+            while (n < batch.size()) {
+                Block& block = batch[n];
+                block.size = src_.read(block.data, block_size_, block.storage);
+                if (block.size == 0) {
+                    end = true;
+                    break;
+                }
+
+                n++;
+                if (block.size < block_size_) {
+                    end = true;
+                    break;
+                }
+            }
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        {
+            HF_STAT_TIME(model_ns);
+
+            run_parallel(n, [&](size_t i) {
+                Block& block = batch[i];
+                std::fill(block.histogram, block.histogram + N_SYMBOLS, 0);
+                count_bytes(block.data, block.size, block.histogram);
+                build_lengths(block.histogram, MAX_CANONICAL_BITS, block.lengths);
+                block.checksum = container::adler32(block.data, block.size);
+            });
+
+            // decision chains through the batch, so it's sequential
+            for (size_t i=0; i<n; i++) {
+                Block& block = batch[i];
+                block.reuse = has_previous
+                    && covers(block.histogram, previous)
+                    && 1 + coded_bits(block.histogram, previous)
+                        <= table_bits(block.lengths) + coded_bits(block.histogram, block.lengths);
+
+                if (block.reuse) {
+                    copy_lengths(previous, block.lengths);
+                    blocks_reused++;
+                }
+                else {
+                    copy_lengths(block.lengths, previous);
+                    has_previous = true;
+                }
+            }
+
+            run_parallel(n, [&](size_t i) {
+                encode_block(batch[i]);
+            });
+        }
+
+        for (size_t i=0; i<n; i++) {
+            Block& block = batch[i];
+            HF_STAT_TIME(io_ns);
+            container::write_frame(dest_, block.size, block.packed, block.checksum);
+
+            input_bytes += block.size;
+            output_bytes += container::FRAME_OVERHEAD + block.packed.size();
+            blocks++;
+        }
+
+        update_progress(input_bytes);
+    }
+
+    if (length == container::UNKNOWN_LENGTH) {
+        container::write_frame(dest_, nullptr, 0, "");
+        output_bytes += container::FRAME_OVERHEAD;
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+    print_stats();
+}
+
+
+void BlockHuffman::decode() {
+    decode(container::read_header(src_));
+}
+
+void BlockHuffman::decode(const container::Header& header) {
+
+    timer_start();
+
+    if (header.get_engine() != container::ENGINE_BLOCK) {
+        throw std::runtime_error("not a block stream");
+    }
+
+    input_bytes += container::HEADER_SIZE;
+
+    if (header.length != container::UNKNOWN_LENGTH) {
+        dest_.reserve(header.length);
+    }
+
+    std::vector<PackedBlock> batch(threads_);
+    CodeLengths previous = { };
+    bool has_previous = false;
+    uint64_t raw_read = 0;
+    bool end = false;
+
+    while (!end) {
+        size_t n = 0;
+        {
+            HF_STAT_TIME(io_ns);
+            while (n < batch.size()) {
+                if (!container::read_next_frame(src_, header, batch[n].frame, raw_read)) {
+                    end = true;
+                    break;
+                }
+
+                n++;
+            }
+        }
+
+        // tables depend on the previous block
+        for (size_t i=0; i<n; i++) {
+            PackedBlock& block = batch[i];
+            bitarr::BitReader reader(block.frame.packed, block.frame.packed_size);
+
+            if (read_table(reader, block.lengths)) {
+                if (!has_previous) {
+                    throw std::runtime_error("corrupt block table (nothing to reuse)");
+                }
+
+                copy_lengths(previous, block.lengths);
+                blocks_reused++;
+            }
+            else {
+                copy_lengths(block.lengths, previous);
+                has_previous = true;
+            }
+
+            block.codes_offset = block.frame.packed_size - reader.get_bits_left() / 8;
+        }
+
+        {
+            HF_STAT_TIME(model_ns);
+            run_parallel(n, [&](size_t i) {
+                decode_block(batch[i]);
+            });
+        }
+
+        for (size_t i=0; i<n; i++) {
+            PackedBlock& block = batch[i];
+            HF_STAT_TIME(io_ns);
+            dest_.write(block.raw.data(), block.raw.size());
+
+            input_bytes += container::FRAME_OVERHEAD + block.frame.packed_size;
+            output_bytes += block.raw.size();
+            blocks++;
+        }
+
+        update_progress(input_bytes);
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+    print_stats();
+}
+
+} // end namespace
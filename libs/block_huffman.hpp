@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+
+#include <chrono>
+
+#include "progress_printer.hpp"
+#include "container.hpp"
+#include "canonical.hpp"
+#include "io.hpp"
+#include "bitwriter.hpp"
+#include "bitreader.hpp"
+
+namespace detail {
+
+// table descriptors of the block engine (see BlockHuffman)
+void write_table(bitarr::BitWriter& writer, const CodeLengths lengths);
+void write_reuse(bitarr::BitWriter& writer);
+// bits of new table descriptor (without padding)
+uint64_t table_bits(const CodeLengths lengths);
+/*
+ * Reads descriptor with its padding, returns true if previous code
+ * is to be reused (lengths untouched), throws std::runtime_error
+ * on malformed table
+ */
+bool read_table(bitarr::BitReader& reader, CodeLengths lengths);
+
+} // namespace end
+
+namespace hf {
+
+const uint32_t DEFAULT_BLOCK_SIZE = 1 << 17;
+
+/*
+ * Semi-adaptive block engine
+ * Input is cut into blocks (one frame each), every block gets
+ * length-limited canonical code built from its own histogram.
+ * Frame payload starts with a table descriptor padded to a byte:
+ *   1                 - reuse code of the previous block
+ *   0 + lengths       - 4 bits per byte value, zero length is followed
+ *                       by 4 bits of count of further zero lengths
+ * Previous code is reused (like DEFLATE does) when it covers all bytes
+ * of the block and costs no more than a new table.
+ * Up to threads blocks are counted and coded at the same time.
+ */
+class BlockHuffman {
+
+    // adapters when constructed over standard streams
+    std::unique_ptr<io::Source> own_src_;
+    std::unique_ptr<io::Sink> own_dest_;
+
+    io::Source& src_;
+    io::Sink& dest_;
+
+    ProgressPrinter* progress_printer_ = nullptr;
+    void update_progress(uint64_t bytes_processed);
+    void finish_progress();
+    bool verbose_ = true;
+
+    std::chrono::time_point<std::chrono::steady_clock> start_, end_;
+    void timer_start();
+    void timer_stop();
+    void timer_print();
+
+    uint32_t block_size_ = DEFAULT_BLOCK_SIZE;
+    unsigned int threads_ = 1;
+
+    size_t input_bytes;
+    size_t output_bytes;
+    size_t blocks;
+    size_t blocks_reused;
+
+    void print_stats();
+
+public:
+    BlockHuffman(io::Source& src, io::Sink& dest);
+    BlockHuffman(std::istream& src, std::ostream& dest);
+
+    void set_progress_printer(ProgressPrinter* printer) { progress_printer_ = printer; }
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    void set_block_size(uint32_t block_size) { block_size_ = block_size; }
+    // blocks coded at the same time (at least 1)
+    void set_threads(unsigned int threads) { threads_ = threads ? threads : 1; }
+
+    void encode();
+    void decode();
+    // header already read by the caller
+    void decode(const container::Header& header);
+};
+
+} // end namespace
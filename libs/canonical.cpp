@@ -0,0 +1,204 @@
+#include "canonical.hpp"
+
+#include <queue>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace detail {
+
+void count_bytes(const char* data, size_t size, Histogram histogram) {
+    // four tables, so that runs of the same byte don't wait for each other's increments
+    uint64_t counts[4][N_SYMBOLS] = { };
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        counts[0][bytes[i]]++;
+        counts[1][bytes[i + 1]]++;
+        counts[2][bytes[i + 2]]++;
+        counts[3][bytes[i + 3]]++;
+    }
+    for (; i < size; i++) {
+        counts[0][bytes[i]]++;
+    }
+
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        histogram[symbol] += counts[0][symbol] + counts[1][symbol] + counts[2][symbol] + counts[3][symbol];
+    }
+}
+
+void build_lengths(const Histogram histogram, int max_bits, CodeLengths lengths) {
+    std::fill(lengths, lengths + N_SYMBOLS, 0);
+
+    std::vector<int> symbols;
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        if (histogram[symbol] > 0) {
+            symbols.push_back(symbol);
+        }
+    }
+
+    if (symbols.empty()) {
+        return;
+    }
+    if (symbols.size() == 1) {
+        lengths[symbols[0]] = 1;
+        return;
+    }
+
+    // plain Huffman tree, leaves are 0..n-1, internal nodes follow
+    size_t n = symbols.size();
+    std::vector<int> parent(2 * n - 1, -1);
+
+    typedef std::pair<uint64_t, int> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    for (size_t i=0; i<n; i++) {
+        queue.push({ histogram[symbols[i]], (int)i });
+    }
+
+    for (size_t node=n; node<2*n-1; node++) {
+        Item a = queue.top();
+        queue.pop();
+        Item b = queue.top();
+        queue.pop();
+
+        parent[a.second] = node;
+        parent[b.second] = node;
+        queue.push({ a.first + b.first, (int)node });
+    }
+
+    // number of codes of each length
+    std::vector<int> count(n + 1, 0);
+    int longest = 0;
+    for (size_t i=0; i<n; i++) {
+        int depth = 0;
+        for (int node=i; parent[node] >= 0; node=parent[node]) {
+            depth++;
+        }
+
+        count[depth]++;
+        longest = std::max(longest, depth);
+    }
+
+    /*
+     * Limit the length (as in JPEG, Annex K.3): two longest codes are
+     * replaced by one a level up, the freed place goes to a code from
+     * a shorter level, which gets two children. Kraft sum is kept at 1.
+     */
+    for (int length=longest; length>max_bits; length--) {
+        while (count[length] > 0) {
+            int shorter = length - 2;
+            while (count[shorter] == 0) {
+                shorter--;
+            }
+
+            count[length] -= 2;
+            count[length - 1]++;
+            count[shorter + 1] += 2;
+            count[shorter]--;
+        }
+    }
+
+    // most frequent symbols get the shortest codes
+    std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) { return histogram[a] > histogram[b]; });
+
+    size_t next = 0;
+    for (int length=1; length<=std::min(longest, max_bits); length++) {
+        for (int i=0; i<count[length]; i++) {
+            lengths[symbols[next++]] = length;
+        }
+    }
+}
+
+uint64_t coded_bits(const Histogram histogram, const CodeLengths lengths) {
+    uint64_t bits = 0;
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        bits += histogram[symbol] * lengths[symbol];
+    }
+
+    return bits;
+}
+
+bool check_lengths(const CodeLengths lengths) {
+    uint32_t kraft = 0;
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        if (lengths[symbol] > MAX_CANONICAL_BITS) {
+            return false;
+        }
+        if (lengths[symbol] > 0) {
+            kraft += 1 << (MAX_CANONICAL_BITS - lengths[symbol]);
+        }
+    }
+
+    return kraft <= (1 << MAX_CANONICAL_BITS);
+}
+
+namespace {
+
+// first code of every length
+void first_codes(const CodeLengths lengths, uint32_t* next_code) {
+    int count[MAX_CANONICAL_BITS + 1] = { };
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        count[lengths[symbol]]++;
+    }
+    count[0] = 0;
+
+    uint32_t code = 0;
+    for (int length=1; length<=MAX_CANONICAL_BITS; length++) {
+        code = (code + count[length - 1]) << 1;
+        next_code[length] = code;
+    }
+}
+
+} // end namespace
+
+void CanonicalEncoder::build(const CodeLengths lengths) {
+    uint32_t next_code[MAX_CANONICAL_BITS + 1];
+    first_codes(lengths, next_code);
+
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        length[symbol] = lengths[symbol];
+        bits[symbol] = lengths[symbol] ? next_code[lengths[symbol]]++ : 0;
+    }
+}
+
+void CanonicalDecoder::build(const CodeLengths lengths) {
+    if (!check_lengths(lengths)) {
+        throw std::runtime_error("corrupt code lengths");
+    }
+
+    std::fill(primary_, primary_ + (1 << PRIMARY_BITS), Entry{ 0, 0, 0 });
+    subtables_.clear();
+
+    uint32_t next_code[MAX_CANONICAL_BITS + 1];
+    first_codes(lengths, next_code);
+
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        int length = lengths[symbol];
+        if (length == 0) {
+            continue;
+        }
+
+        uint32_t code = next_code[length]++;
+        Entry entry = { (uint16_t)symbol, (uint8_t)length, 0 };
+
+        if (length <= PRIMARY_BITS) {
+            // all entries starting with the code
+            uint32_t first = code << (PRIMARY_BITS - length);
+            std::fill(primary_ + first, primary_ + first + (1 << (PRIMARY_BITS - length)), entry);
+            continue;
+        }
+
+        Entry& link = primary_[code >> (length - PRIMARY_BITS)];
+        if (!link.is_subtable) {
+            link = { (uint16_t)(subtables_.size() >> SUBTABLE_BITS), 0, 1 };
+            subtables_.resize(subtables_.size() + (1 << SUBTABLE_BITS), Entry{ 0, 0, 0 });
+        }
+
+        uint32_t suffix = code & ((1 << (length - PRIMARY_BITS)) - 1);
+        size_t first = ((size_t)link.value << SUBTABLE_BITS) + (suffix << (MAX_CANONICAL_BITS - length));
+        std::fill(subtables_.begin() + first, subtables_.begin() + first + (1 << (MAX_CANONICAL_BITS - length)), entry);
+    }
+}
+
+} // namespace end
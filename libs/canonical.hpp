@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <stdexcept>
+
+#include "bitreader.hpp"
+
+namespace detail {
+
+/*
+ * Canonical (static) Huffman codes
+ * Only code lengths are needed to rebuild the code: symbols are sorted
+ * by length, then by value, and get consecutive codes.
+ */
+const int N_SYMBOLS = 256;
+const int MAX_CANONICAL_BITS = 15;
+
+// decoding: first level indexed by PRIMARY_BITS, longer codes continue in subtables
+const int PRIMARY_BITS = 10;
+const int SUBTABLE_BITS = MAX_CANONICAL_BITS - PRIMARY_BITS;
+
+typedef uint64_t Histogram[N_SYMBOLS];
+typedef uint8_t CodeLengths[N_SYMBOLS];
+
+void count_bytes(const char* data, size_t size, Histogram histogram);
+
+/*
+ * Lengths of optimal prefix code limited to max_bits (0 for absent symbols),
+ * a single symbol gets length 1
+ */
+void build_lengths(const Histogram histogram, int max_bits, CodeLengths lengths);
+
+// total size of the coded data in bits
+uint64_t coded_bits(const Histogram histogram, const CodeLengths lengths);
+
+// lengths describe a valid prefix code (not oversubscribed, <= MAX_CANONICAL_BITS)
+bool check_lengths(const CodeLengths lengths);
+
+/*
+ * Flat code table
+ */
+struct CanonicalEncoder {
+    uint32_t bits[N_SYMBOLS];
+    uint8_t length[N_SYMBOLS];
+
+    void build(const CodeLengths lengths);
+};
+
+/*
+ * Multi-level decoding tables
+ */
+class CanonicalDecoder {
+
+    struct Entry {
+        uint16_t value;  // symbol or subtable
+        uint8_t length;  // whole code length, 0 for unused codes
+        uint8_t is_subtable;
+    };
+
+    Entry primary_[1 << PRIMARY_BITS];
+    std::vector<Entry> subtables_;
+
+public:
+    void build(const CodeLengths lengths);
+
+    // throws std::runtime_error on code not in the table
+    uint8_t decode(bitarr::BitReader& reader) const;
+};
+
+/*
+ * Implementations
+ */
+
+inline uint8_t CanonicalDecoder::decode(bitarr::BitReader& reader) const {
+    reader.refill();
+
+    unsigned int bits = reader.peek(MAX_CANONICAL_BITS);
+    Entry entry = primary_[bits >> SUBTABLE_BITS];
+
+    if (entry.is_subtable) {
+        entry = subtables_[(entry.value << SUBTABLE_BITS) | (bits & ((1 << SUBTABLE_BITS) - 1))];
+    }
+
+    if (entry.length == 0) {
+        throw std::runtime_error("corrupt frame (invalid code)");
+    }
+
+    reader.consume(entry.length);
+    return entry.value;
+}
+
+} // namespace end
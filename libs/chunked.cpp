@@ -0,0 +1,365 @@
+#include "chunked.hpp"
+
+#include "huffman.hpp"
+#include "parallel.hpp"
+
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+using namespace std::chrono;
+
+namespace hf {
+
+ChunkedHuffman::ChunkedHuffman(io::Source& src, io::Sink& dest, unsigned int threads, size_t chunk_size)
+    : src_(src), dest_(dest), threads_(threads ? threads : 1), chunk_size_(chunk_size),
+      input_bytes(0), output_bytes(0) {
+
+    if (chunk_size_ == 0 || chunk_size_ > UINT32_MAX) {
+        throw std::invalid_argument("invalid chunk size");
+    }
+}
+
+void ChunkedHuffman::update_progress(uint64_t bytes_processed) {
+    if (progress_printer_) {
+        progress_printer_->progress_update(bytes_processed);
+    }
+}
+
+void ChunkedHuffman::finish_progress() {
+    if (progress_printer_) {
+        progress_printer_->finish();
+    }
+}
+
+void ChunkedHuffman::timer_start() {
+    start_ = std::chrono::steady_clock::now();
+}
+
+void ChunkedHuffman::timer_stop() {
+    end_ = std::chrono::steady_clock::now();
+}
+
+void ChunkedHuffman::timer_print() {
+    auto duration = duration_cast<microseconds>(end_ - start_);
+    cout << "took " << std::fixed << duration.count() / 1000000. << "s" << endl;
+}
+
+std::string ChunkedHuffman::encode_chunk(const char* raw, size_t raw_size) const {
+    Huffman coder(src_, dest_, updater_);
+    coder.set_verbose(false);
+    coder.set_dictionary(dictionary_);
+    coder.set_aging(aging_);
+    coder.reset_model();
+
+    std::string packed;
+    coder.encode_frame(raw, raw_size, packed);
+
+    return packed;
+}
+
+std::string ChunkedHuffman::decode_chunk(const container::Frame& frame) const {
+    Huffman coder(src_, dest_, updater_);
+    coder.set_verbose(false);
+    coder.set_dictionary(dictionary_);
+    coder.set_aging(aging_);
+    coder.reset_model();
+
+    std::string raw(frame.raw_size, 0);
+    coder.decode_frame(frame.packed, frame.packed_size, &raw[0], raw.size());
+    container::check_frame(frame, raw.data(), raw.size());
+
+    return raw;
+}
+
+
+// frames from a checkpoint up to the next one (or segment_bytes_ of them)
+struct ChunkedHuffman::Segment {
+    // frames point into their storage, so they don't move
+    std::vector<std::unique_ptr<container::Frame>> frames;
+    std::string raw;
+    std::unique_ptr<Huffman> coder;
+    // frames follow the previous round's last segment, its coder carries over
+    bool continued = false;
+};
+
+void ChunkedHuffman::decode_segment(Segment& segment) const {
+    if (!segment.continued) {
+        segment.coder.reset(new Huffman(src_, dest_, updater_));
+        segment.coder->set_verbose(false);
+        segment.coder->set_dictionary(dictionary_);
+        segment.coder->set_aging(aging_);
+        segment.coder->reset_model();
+    }
+
+    Huffman& coder = *segment.coder;
+    segment.raw.clear();
+    for (const auto& frame : segment.frames) {
+        size_t start = segment.raw.size();
+        segment.raw.resize(start + frame->raw_size);
+
+        size_t skip = coder.load_checkpoint(frame->packed, frame->packed_size);
+        coder.decode_frame(frame->packed + skip, frame->packed_size - skip, &segment.raw[start], frame->raw_size);
+        container::check_frame(*frame, &segment.raw[start], frame->raw_size);
+    }
+}
+
+void ChunkedHuffman::decode_checkpointed(const container::Header& header) {
+    size_t n_segments_total = 0;
+    uint64_t raw_read = 0;
+    std::vector<Segment> segments(threads_);
+    // first frame of the next segment
+    std::unique_ptr<container::Frame> next;
+    // last segment was cut at segment_bytes_, the next round continues it
+    bool cut = false;
+
+    bool end = false;
+    while (!end || next) {
+
+        // read up to one segment per thread
+        size_t n_segments = 0;
+        while (n_segments < threads_ && (!end || next)) {
+            Segment& segment = segments[n_segments];
+            segment.frames.clear();
+            segment.continued = cut;
+            cut = false;
+            if (next) {
+                segment.frames.push_back(std::move(next));
+            }
+
+            uint64_t segment_bytes = 0;
+            while (!end) {
+                if (segment_bytes >= segment_bytes_ && !segment.frames.empty()) {
+                    cut = true;
+                    break;
+                }
+
+                std::unique_ptr<container::Frame> frame(new container::Frame());
+                if (!container::read_next_frame(src_, header, *frame, raw_read)) {
+                    end = true;
+                    break;
+                }
+                input_bytes += container::FRAME_OVERHEAD + frame->packed_size;
+
+                if (container::is_checkpoint(*frame) && !segment.frames.empty()) {
+                    next = std::move(frame);
+                    break;
+                }
+                segment_bytes += frame->raw_size;
+                segment.frames.push_back(std::move(frame));
+            }
+
+            if (!segment.frames.empty()) {
+                n_segments++;
+            }
+            if (cut) {
+                // decoded before the rest of it
+                break;
+            }
+        }
+
+        detail::run_parallel(n_segments, [&](size_t i) { decode_segment(segments[i]); });
+
+        for (size_t i=0; i<n_segments; i++) {
+            dest_.write(segments[i].raw.data(), segments[i].raw.size());
+            output_bytes += segments[i].raw.size();
+        }
+
+        if (cut) {
+            std::swap(segments[0].coder, segments[n_segments - 1].coder);
+        }
+
+        n_segments_total += n_segments;
+        update_progress(input_bytes);
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+
+    cout << "segments " << n_segments_total << " threads " << threads_ << endl;
+    cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
+    timer_print();
+}
+
+
+void ChunkedHuffman::encode() {
+
+    timer_start();
+
+    if (dictionary_) {
+        updater_ = dictionary_->get_updater();
+    }
+
+    container::Header header;
+    header.flags = (updater_ == detail::VITTER ? container::FLAG_VITTER : 0) | container::FLAG_INDEPENDENT |
+                   (dictionary_ ? container::FLAG_DICTIONARY : 0) |
+                   (seekable_ ? container::FLAG_SEEKABLE : 0) |
+                   (aging_ ? container::FLAG_AGING : 0);
+    header.frame_size = chunk_size_;
+    header.length = src_.remaining();
+    header.dictionary_id = dictionary_ ? dictionary_->get_id() : 0;
+
+    container::write_header(dest_, header);
+    output_bytes += container::HEADER_SIZE;
+
+    size_t n_chunks_total = 0;
+    std::vector<uint64_t> offsets;
+    std::vector<const char*> raw(threads_);
+    std::vector<size_t> raw_size(threads_);
+    std::vector<std::string> storage(threads_);
+    std::vector<std::string> packed(threads_);
+
+    bool eof = false;
+    while (!eof) {
+
+        // read up to one chunk per thread
+        size_t n_chunks = 0;
+        while (n_chunks < threads_) {
+            raw_size[n_chunks] = src_.read(raw[n_chunks], chunk_size_, storage[n_chunks]);
+
+            if (raw_size[n_chunks] < chunk_size_) {
+                eof = true;
+            }
+            if (raw_size[n_chunks] == 0) {
+                break;
+            }
+
+            n_chunks++;
+            if (eof) {
+                break;
+            }
+        }
+
+        detail::run_parallel(n_chunks, [&](size_t i) { packed[i] = encode_chunk(raw[i], raw_size[i]); });
+
+        // write in order
+        for (size_t i=0; i<n_chunks; i++) {
+            offsets.push_back(output_bytes);
+            container::write_frame(dest_, raw[i], raw_size[i], packed[i]);
+
+            input_bytes += raw_size[i];
+            output_bytes += container::FRAME_OVERHEAD + packed[i].size();
+        }
+
+        n_chunks_total += n_chunks;
+        update_progress(input_bytes);
+    }
+
+    if (header.length == container::UNKNOWN_LENGTH) {
+        // empty frame ends the stream
+        container::write_frame(dest_, nullptr, 0, "");
+        output_bytes += container::FRAME_OVERHEAD;
+    }
+    else if (input_bytes != header.length) {
+        throw std::runtime_error("source size changed while packing");
+    }
+
+    if (seekable_) {
+        container::write_index(dest_, offsets);
+        output_bytes += offsets.size() * container::INDEX_ENTRY_SIZE + container::INDEX_TRAILER_SIZE;
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+
+    cout << "chunks " << n_chunks_total << " threads " << threads_ << endl;
+    cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
+    cout.precision(2);
+    float percent = ((float)input_bytes - output_bytes) / input_bytes * 100;
+    cout << "size reduction " << std::fixed << percent << "%" << (percent < 0 ? " (output bigger)" : "") << endl;
+    timer_print();
+}
+
+void ChunkedHuffman::decode() {
+    decode(container::read_header(src_));
+}
+
+void ChunkedHuffman::decode(const container::Header& header) {
+
+    timer_start();
+
+    input_bytes += container::HEADER_SIZE;
+
+    if (header.get_engine() != container::ENGINE_ADAPTIVE ||
+        !(header.flags & container::FLAG_INDEPENDENT || header.has_checkpoints())) {
+        throw std::runtime_error("frames depend on each other, decode without --threads");
+    }
+
+    updater_ = header.flags & container::FLAG_VITTER ? detail::VITTER : detail::FGK;
+    aging_ = header.flags & container::FLAG_AGING;
+    check_dictionary(header, dictionary_);
+    if (!(header.flags & container::FLAG_DICTIONARY)) {
+        dictionary_ = nullptr;
+    }
+
+    if (header.length != container::UNKNOWN_LENGTH) {
+        dest_.reserve(header.length);
+    }
+
+    if (header.has_checkpoints()) {
+        decode_checkpointed(header);
+        return;
+    }
+
+    size_t n_chunks_total = 0;
+    std::vector<container::Frame> frames(threads_);
+    std::vector<std::string> raw(threads_);
+
+    bool end = header.length == 0;
+    while (!end) {
+
+        // read up to one frame per thread
+        size_t n_chunks = 0;
+        while (n_chunks < threads_ && !end) {
+            container::Frame& frame = frames[n_chunks];
+            container::read_frame(src_, header, frame);
+            input_bytes += container::FRAME_OVERHEAD + frame.packed_size;
+
+            if (header.length == container::UNKNOWN_LENGTH) {
+                if (frame.raw_size == 0) {
+                    end = true;
+                    break;
+                }
+            }
+            else {
+                uint64_t remaining = header.length - (output_bytes + n_chunks * header.frame_size);
+                if (frame.raw_size != std::min<uint64_t>(header.frame_size, remaining)) {
+                    throw std::runtime_error("corrupt frame header");
+                }
+
+                end = frame.raw_size == remaining;
+            }
+
+            n_chunks++;
+        }
+
+        detail::run_parallel(n_chunks, [&](size_t i) { raw[i] = decode_chunk(frames[i]); });
+
+        for (size_t i=0; i<n_chunks; i++) {
+            dest_.write(raw[i].data(), raw[i].size());
+            output_bytes += raw[i].size();
+        }
+
+        n_chunks_total += n_chunks;
+        update_progress(input_bytes);
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+
+    cout << "chunks " << n_chunks_total << " threads " << threads_ << endl;
+    cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
+    timer_print();
+}
+
+} // end namespace
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include <chrono>
+
+#include "progress_printer.hpp"
+#include "huffnode.hpp"
+#include "container.hpp"
+#include "dictionary.hpp"
+#include "io.hpp"
+
+namespace hf {
+
+/*
+ * Chunked mode
+ * Input is split into chunks (frames of the container with INDEPENDENT flag),
+ * every chunk is coded by a separate Huffman instance (with its own tree),
+ * so chunks can be coded in parallel. Output doesn't depend on the number
+ * of threads, only on the chunk size. See container.hpp for the layout.
+ * CHECKPOINTED single streams are decoded in parallel too, a segment
+ * (frames from one checkpoint to the next one) per thread.
+ */
+class ChunkedHuffman {
+
+    io::Source& src_;
+    io::Sink& dest_;
+
+    unsigned int threads_;
+    size_t chunk_size_;
+    detail::Updater updater_ = detail::FGK;
+    const Dictionary* dictionary_ = nullptr;
+    bool seekable_ = false;
+    bool aging_ = false;
+    uint64_t segment_bytes_ = 64 << 20;
+
+    ProgressPrinter* progress_printer_ = nullptr;
+    void update_progress(uint64_t bytes_processed);
+    void finish_progress();
+
+    std::chrono::time_point<std::chrono::steady_clock> start_, end_;
+    void timer_start();
+    void timer_stop();
+    void timer_print();
+
+    size_t input_bytes;
+    size_t output_bytes;
+
+    std::string encode_chunk(const char* raw, size_t raw_size) const;
+    std::string decode_chunk(const container::Frame& frame) const;
+
+    struct Segment;
+    void decode_segment(Segment& segment) const;
+    void decode_checkpointed(const container::Header& header);
+
+public:
+    ChunkedHuffman(io::Source& src, io::Sink& dest, unsigned int threads, size_t chunk_size);
+
+    void set_progress_printer(ProgressPrinter* printer) { progress_printer_ = printer; }
+    void set_updater(detail::Updater updater) { updater_ = updater; }
+    // every chunk starts from the dictionary (see Huffman::set_dictionary)
+    void set_dictionary(const Dictionary* dictionary) { dictionary_ = dictionary; }
+    // index of chunks at the end (see SeekableReader)
+    void set_seekable(bool seekable) { seekable_ = seekable; }
+    void set_aging(bool enabled) { aging_ = enabled; }
+    /*
+     * Raw bytes of a segment decoded at once (checkpointed streams), longer
+     * segments (a stream without checkpoints is one) continue in the next
+     * round with the same model, so memory doesn't grow with the stream
+     */
+    void set_segment_bytes(uint64_t bytes) { segment_bytes_ = bytes; }
+
+    void encode();
+    void decode();
+    // header already read by the caller
+    void decode(const container::Header& header);
+};
+
+} // end namespace
@@ -0,0 +1,296 @@
+#include "container.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace hf {
+namespace container {
+
+namespace {
+
+const char INDEX_MAGIC[4] = { 'H', 'U', 'F', 'X' };
+const char MODEL_MAGIC[4] = { 'H', 'U', 'F', 'M' };
+
+void put_u32(char* buf, uint32_t value) {
+    for (int i=0; i<4; i++) {
+        buf[i] = value >> (8*i);
+    }
+}
+
+void put_u64(char* buf, uint64_t value) {
+    put_u32(buf, value);
+    put_u32(buf + 4, value >> 32);
+}
+
+uint32_t get_u32(const char* buf) {
+    uint32_t value = 0;
+    for (int i=0; i<4; i++) {
+        value |= (uint32_t)(uint8_t)buf[i] << (8*i);
+    }
+
+    return value;
+}
+
+uint64_t get_u64(const char* buf) {
+    return get_u32(buf) | ((uint64_t)get_u32(buf + 4) << 32);
+}
+
+// exactly size bytes or exception
+const char* take(io::Source& source, size_t size, std::string& storage) {
+    const char* data;
+    if (source.read(data, size, storage) != size) {
+        throw std::runtime_error("truncated stream");
+    }
+
+    return data;
+}
+
+/*
+ * Longest possible code is NYT (MAX_CODE_BITS) followed by 8-bit literal,
+ * payloads of CHECKPOINTED streams may start with a snapshot
+ */
+uint64_t max_packed_size(uint32_t raw_size) {
+    return (uint64_t)raw_size * 9 + 1 + MAX_SNAPSHOT_SIZE;
+}
+
+} // end namespace
+
+
+void write_header(io::Sink& sink, const Header& header) {
+    char buf[HEADER_SIZE];
+    std::copy(MAGIC, MAGIC + 4, buf);
+    buf[4] = VERSION;
+    buf[5] = header.flags;
+    buf[6] = (char)header.dictionary_id;
+    buf[7] = (char)(header.dictionary_id >> 8);
+    put_u32(buf + 8, header.frame_size);
+    put_u64(buf + 12, header.length);
+
+    sink.write(buf, HEADER_SIZE);
+}
+
+Header read_header(io::Source& source) {
+    std::string storage;
+    const char* data;
+    size_t size = source.read(data, HEADER_SIZE, storage);
+
+    if (size < 4 || !std::equal(data, data + 4, MAGIC)) {
+        throw std::runtime_error("not a huffman stream");
+    }
+    if (size < HEADER_SIZE) {
+        throw std::runtime_error("truncated stream");
+    }
+
+    if ((uint8_t)data[4] != VERSION) {
+        throw std::runtime_error("unsupported format version");
+    }
+
+    Header header;
+    header.flags = data[5];
+    if (header.flags & ~KNOWN_FLAGS) {
+        throw std::runtime_error("unsupported format flags");
+    }
+
+    header.dictionary_id = (uint8_t)data[6] | (uint8_t)data[7] << 8;
+    header.frame_size = get_u32(data + 8);
+    header.length = get_u64(data + 12);
+    if (header.frame_size == 0) {
+        throw std::runtime_error("invalid frame size");
+    }
+
+    return header;
+}
+
+void write_frame(io::Sink& sink, const char* raw, size_t raw_size, const std::string& packed) {
+    write_frame(sink, raw_size, packed, adler32(raw, raw_size));
+}
+
+void write_frame(io::Sink& sink, uint32_t raw_size, const std::string& packed, uint32_t checksum) {
+    char buf[8];
+    put_u32(buf, raw_size);
+    put_u32(buf + 4, packed.size());
+    sink.write(buf, 8);
+
+    sink.write(packed.data(), packed.size());
+
+    put_u32(buf, checksum);
+    sink.write(buf, 4);
+}
+
+void read_frame(io::Source& source, const Header& header, Frame& frame) {
+    const char* sizes = take(source, 8, frame.storage);
+    frame.raw_size = get_u32(sizes);
+    frame.packed_size = get_u32(sizes + 4);
+
+    if (frame.raw_size > header.frame_size || frame.packed_size > max_packed_size(frame.raw_size)) {
+        throw std::runtime_error("corrupt frame header");
+    }
+
+    // payload and checksum in one piece
+    const char* data = take(source, frame.packed_size + 4, frame.storage);
+    frame.packed = data;
+    frame.checksum = get_u32(data + frame.packed_size);
+}
+
+bool read_next_frame(io::Source& source, const Header& header, Frame& frame, uint64_t& raw_read) {
+    if (header.length != UNKNOWN_LENGTH && raw_read == header.length) {
+        return false;
+    }
+
+    read_frame(source, header, frame);
+
+    if (header.length == UNKNOWN_LENGTH) {
+        if (frame.raw_size == 0) {
+            return false;
+        }
+    }
+    else if (frame.raw_size != std::min<uint64_t>(header.frame_size, header.length - raw_read)) {
+        throw std::runtime_error("corrupt frame header");
+    }
+
+    raw_read += frame.raw_size;
+    return true;
+}
+
+void write_index(io::Sink& sink, const std::vector<uint64_t>& offsets) {
+    std::string index(offsets.size() * INDEX_ENTRY_SIZE + INDEX_TRAILER_SIZE, 0);
+    for (size_t i=0; i<offsets.size(); i++) {
+        put_u64(&index[i * INDEX_ENTRY_SIZE], offsets[i]);
+    }
+
+    char* trailer = &index[offsets.size() * INDEX_ENTRY_SIZE];
+    put_u32(trailer, offsets.size());
+    put_u32(trailer + 4, adler32(index.data(), offsets.size() * INDEX_ENTRY_SIZE));
+    std::copy(INDEX_MAGIC, INDEX_MAGIC + 4, trailer + 8);
+
+    sink.write(index.data(), index.size());
+}
+
+void read_index(const char* data, size_t size, std::vector<uint64_t>& offsets) {
+    if (size < HEADER_SIZE + INDEX_TRAILER_SIZE) {
+        throw std::runtime_error("no index (not a seekable stream)");
+    }
+
+    const char* trailer = data + size - INDEX_TRAILER_SIZE;
+    if (!std::equal(INDEX_MAGIC, INDEX_MAGIC + 4, trailer + 8)) {
+        throw std::runtime_error("no index (not a seekable stream)");
+    }
+
+    uint32_t count = get_u32(trailer);
+    if (count > (size - HEADER_SIZE - INDEX_TRAILER_SIZE) / INDEX_ENTRY_SIZE) {
+        throw std::runtime_error("corrupt index");
+    }
+
+    const char* index = trailer - count * INDEX_ENTRY_SIZE;
+    if (adler32(index, count * INDEX_ENTRY_SIZE) != get_u32(trailer + 4)) {
+        throw std::runtime_error("corrupt index (checksum)");
+    }
+
+    // frames lie between the header and the index
+    offsets.resize(count);
+    uint64_t previous = HEADER_SIZE;
+    for (uint32_t i=0; i<count; i++) {
+        offsets[i] = get_u64(index + i * INDEX_ENTRY_SIZE);
+
+        bool first_ok = i > 0 || offsets[i] >= HEADER_SIZE;
+        bool ordered = i == 0 || offsets[i] >= previous + FRAME_OVERHEAD;
+        if (!first_ok || !ordered || offsets[i] + FRAME_OVERHEAD > (uint64_t)(index - data)) {
+            throw std::runtime_error("corrupt index");
+        }
+
+        previous = offsets[i];
+    }
+}
+
+void write_model(io::Sink& sink, const std::string& model) {
+    char trailer[MODEL_TRAILER_SIZE];
+    put_u32(trailer, model.size());
+    put_u32(trailer + 4, adler32(model.data(), model.size()));
+    std::copy(MODEL_MAGIC, MODEL_MAGIC + 4, trailer + 8);
+
+    sink.write(model.data(), model.size());
+    sink.write(trailer, MODEL_TRAILER_SIZE);
+}
+
+void read_model(const char* data, size_t size, std::string& model) {
+    if (size < HEADER_SIZE + MODEL_TRAILER_SIZE) {
+        throw std::runtime_error("no model (not an appendable stream)");
+    }
+
+    const char* trailer = data + size - MODEL_TRAILER_SIZE;
+    if (!std::equal(MODEL_MAGIC, MODEL_MAGIC + 4, trailer + 8)) {
+        throw std::runtime_error("no model (not an appendable stream)");
+    }
+
+    uint32_t model_size = get_u32(trailer);
+    if (model_size > size - HEADER_SIZE - MODEL_TRAILER_SIZE) {
+        throw std::runtime_error("corrupt model");
+    }
+
+    const char* start = trailer - model_size;
+    if (adler32(start, model_size) != get_u32(trailer + 4)) {
+        throw std::runtime_error("corrupt model (checksum)");
+    }
+
+    model.assign(start, model_size);
+}
+
+void write_lengths(io::Sink& sink, const uint8_t* lengths) {
+    char buf[LENGTHS_SIZE];
+    for (size_t i=0; i<LENGTHS_SIZE; i++) {
+        buf[i] = lengths[2*i] << 4 | lengths[2*i + 1];
+    }
+
+    sink.write(buf, LENGTHS_SIZE);
+}
+
+void read_lengths(io::Source& source, uint8_t* lengths) {
+    std::string storage;
+    const char* data = take(source, LENGTHS_SIZE, storage);
+
+    for (size_t i=0; i<LENGTHS_SIZE; i++) {
+        lengths[2*i] = (uint8_t)data[i] >> 4;
+        lengths[2*i + 1] = data[i] & 0x0F;
+    }
+}
+
+void check_frame(const Frame& frame, const char* raw, size_t raw_size) {
+    if (raw_size != frame.raw_size) {
+        throw std::runtime_error("frame size mismatch");
+    }
+
+    check_frame(frame.checksum, raw, raw_size);
+}
+
+void check_frame(uint32_t checksum, const char* raw, size_t raw_size) {
+    if (adler32(raw, raw_size) != checksum) {
+        throw std::runtime_error("checksum mismatch");
+    }
+}
+
+uint32_t adler32(const char* data, size_t size, uint32_t adler) {
+    const uint32_t MOD = 65521;
+    // largest n such that 255n(n+1)/2 + (n+1)(MOD-1) fits in 32 bits
+    const size_t NMAX = 5552;
+
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+
+    while (size > 0) {
+        size_t n = std::min(size, NMAX);
+        size -= n;
+
+        while (n--) {
+            a += (uint8_t)*data++;
+            b += a;
+        }
+
+        a %= MOD;
+        b %= MOD;
+    }
+
+    return (b << 16) | a;
+}
+
+} // end namespace
+} // end namespace
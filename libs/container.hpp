@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "io.hpp"
+
+namespace hf {
+namespace container {
+
+/*
+ * Framed stream format (integers are little endian)
+ *
+ *   header: magic "HUFF", version u8, flags u8, dictionary_id u16,
+ *           frame_size u32, length u64 (of the original data)
+ *   frame:  raw_size u32, packed_size u32, payload, Adler-32 of raw data u32
+ *
+ * Every frame but the last one holds exactly frame_size bytes, the stream
+ * ends right after the frame completing length bytes. If the length wasn't
+ * known when packing (UNKNOWN_LENGTH) an empty frame ends the stream.
+ * Such streams may also have frames shorter than frame_size before the end,
+ * these are flush points (see Huffman::flush()), decoders write out the
+ * data up to them right away.
+ *
+ * Payload is padded to a full byte. The tree carries over to the next
+ * frame unless INDEPENDENT flag is set (then frames can be decoded in parallel).
+ * With DICTIONARY flag the tree starts from a pre-trained one (every frame
+ * if INDEPENDENT), dictionary_id identifies it (zero without the flag).
+ *
+ * With AGING flag counts of the tree are halved whenever the root count
+ * reaches AGING_COUNT_LIMIT (see HuffTree::set_count_limit).
+ *
+ * SEEKABLE streams (always INDEPENDENT) end with an index of frames,
+ * so a range of the data can be decoded without the frames before it:
+ *
+ *   index:   offset u64 of every frame (of its raw_size, from the header start)
+ *   trailer: frame count u32, Adler-32 of the offsets u32, magic "HUFX"
+ *
+ * Index follows the last frame (the empty one if the length wasn't known),
+ * sequential decoders stop before it.
+ *
+ * SEEKABLE without INDEPENDENT is a CHECKPOINTED stream, the tree carries
+ * over, but every payload starts with a snapshot flag u8, at checkpoints
+ * it's 1 and a snapshot of the model follows:
+ *
+ *   snapshot: symbols u16, then symbol u8 and its count (LEB128)
+ *             for every symbol transferred so far
+ *
+ * At a checkpoint both sides build their trees from these counts
+ * (HuffTree::set_counts), so decoding can start at any checkpoint frame.
+ * Encoders halve the counts of a snapshot (nonzero ones stay nonzero) until
+ * they sum to less than CHECKPOINT_COUNT_LIMIT, and make a checkpoint of
+ * any frame starting with more, so the counts stay in range however long
+ * the stream is.
+ *
+ * APPENDABLE streams are CHECKPOINTED streams of unknown length with
+ * the model after the last frame between the frames and the index:
+ *
+ *   model:   snapshot flag u8 and snapshot (as at a checkpoint),
+ *            their size u32, Adler-32 of them u32, magic "HUFM"
+ *
+ * Their last frame, if not full, is a checkpoint, so more data can be
+ * appended without decoding more than that frame (see Huffman::resume).
+ *
+ * Engine bits of flags select the coder:
+ *   ADAPTIVE - adaptive Huffman tree (FGK or Vitter)
+ *   STATIC   - canonical code for the whole input, header is followed
+ *              by code lengths (4 bits per byte value, 128 bytes)
+ *   BLOCK    - canonical code per frame (block), payload starts with
+ *              its table or a mark to reuse the previous block's one
+ */
+const char MAGIC[4] = { 'H', 'U', 'F', 'F' };
+const uint8_t VERSION = 1;
+
+const uint8_t FLAG_VITTER = 0x01;
+const uint8_t FLAG_INDEPENDENT = 0x02;
+const uint8_t FLAG_DICTIONARY = 0x10;
+const uint8_t FLAG_SEEKABLE = 0x20;
+const uint8_t FLAG_AGING = 0x40;
+
+const uint8_t ENGINE_MASK = 0x0C;
+const uint8_t ENGINE_ADAPTIVE = 0x00;
+const uint8_t ENGINE_STATIC = 0x04;
+const uint8_t ENGINE_BLOCK = 0x08;
+
+const uint8_t KNOWN_FLAGS = FLAG_VITTER | FLAG_INDEPENDENT | FLAG_DICTIONARY | FLAG_SEEKABLE | FLAG_AGING | ENGINE_MASK;
+
+const uint64_t UNKNOWN_LENGTH = io::UNKNOWN_SIZE;
+const uint32_t DEFAULT_FRAME_SIZE = 1 << 20;
+const int AGING_COUNT_LIMIT = 1 << 14;
+const int CHECKPOINT_COUNT_LIMIT = 1 << 28;
+
+const size_t HEADER_SIZE = 20;
+const size_t FRAME_OVERHEAD = 12;
+const size_t LENGTHS_SIZE = 128;
+const size_t INDEX_ENTRY_SIZE = 8;
+const size_t INDEX_TRAILER_SIZE = 12;
+const size_t MODEL_TRAILER_SIZE = 12;
+// snapshot flag, symbols, then symbol and 5-byte LEB128 count for all of them
+const size_t MAX_SNAPSHOT_SIZE = 1 + 2 + 256 * 6;
+
+struct Header {
+    uint8_t flags = 0;
+    uint32_t frame_size = DEFAULT_FRAME_SIZE;
+    uint64_t length = UNKNOWN_LENGTH;
+    uint16_t dictionary_id = 0;
+
+    uint8_t get_engine() const { return flags & ENGINE_MASK; }
+    bool has_checkpoints() const { return (flags & FLAG_SEEKABLE) && !(flags & FLAG_INDEPENDENT); }
+};
+
+struct Frame {
+    uint32_t raw_size = 0;
+    uint32_t checksum = 0;
+
+    // payload points into the source (if mapped) or into storage
+    const char* packed = nullptr;
+    uint32_t packed_size = 0;
+    std::string storage;
+};
+
+void write_header(io::Sink& sink, const Header& header);
+// throws std::runtime_error if it's not a valid header
+Header read_header(io::Source& source);
+
+void write_frame(io::Sink& sink, const char* raw, size_t raw_size, const std::string& packed);
+// checksum of raw data computed by the caller
+void write_frame(io::Sink& sink, uint32_t raw_size, const std::string& packed, uint32_t checksum);
+// throws std::runtime_error on truncated or malformed frame
+void read_frame(io::Source& source, const Header& header, Frame& frame);
+/*
+ * Reads the next frame and checks its size against the header,
+ * returns false at the end of stream (raw_read counts decoded bytes)
+ */
+bool read_next_frame(io::Source& source, const Header& header, Frame& frame, uint64_t& raw_read);
+
+void write_index(io::Sink& sink, const std::vector<uint64_t>& offsets);
+/*
+ * Index at the end of the whole stream (data, size), offsets are checked
+ * to increase and stay within it, throws std::runtime_error otherwise
+ */
+void read_index(const char* data, size_t size, std::vector<uint64_t>& offsets);
+// where the index of count frames starts (within a stream of size bytes)
+inline size_t index_start(size_t size, size_t count) { return size - INDEX_TRAILER_SIZE - count * INDEX_ENTRY_SIZE; }
+
+// model of an APPENDABLE stream (written before its index)
+void write_model(io::Sink& sink, const std::string& model);
+/*
+ * Model ending at size (where the index starts), throws
+ * std::runtime_error if there's none or it's corrupt
+ */
+void read_model(const char* data, size_t size, std::string& model);
+
+// code lengths of STATIC engine (values up to 15)
+void write_lengths(io::Sink& sink, const uint8_t* lengths);
+void read_lengths(io::Source& source, uint8_t* lengths);
+
+// frame of a CHECKPOINTED stream with model snapshots
+inline bool is_checkpoint(const Frame& frame) { return frame.packed_size > 0 && frame.packed[0] != 0; }
+
+// throws std::runtime_error if raw data don't match the frame
+void check_frame(const Frame& frame, const char* raw, size_t raw_size);
+void check_frame(uint32_t checksum, const char* raw, size_t raw_size);
+
+uint32_t adler32(const char* data, size_t size, uint32_t adler = 1);
+
+} // end namespace
+} // end namespace
@@ -0,0 +1,139 @@
+#include "dictionary.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace detail;
+
+namespace hf {
+
+namespace {
+
+const char MAGIC[4] = { 'H', 'U', 'F', 'D' };
+const uint8_t VERSION = 1;
+
+const size_t FILE_HEADER_SIZE = 9;
+const size_t FILE_TRAILER_SIZE = 4;
+
+void put_u32(char* out, uint32_t value) {
+    for (int i=0; i<4; i++) {
+        out[i] = (char)(value >> (8 * i));
+    }
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t value = 0;
+    for (int i=0; i<4; i++) {
+        value |= (uint32_t)(uint8_t)in[i] << (8 * i);
+    }
+
+    return value;
+}
+
+} // end namespace
+
+void Dictionary::set_state() {
+    state_.clear();
+    tree_.save(state_);
+
+    uint32_t checksum = container::adler32(state_.data(), state_.size());
+    id_ = (uint16_t)(checksum ^ (checksum >> 16));
+
+    // copies start with all codes built
+    for (int s=0; s<N_SYMBOLS; s++) {
+        if (tree_.get_leaf(s) != NO_NODE) {
+            tree_.get_code(tree_.get_leaf(s));
+        }
+    }
+    tree_.get_code(tree_.get_nyt());
+}
+
+Dictionary::Dictionary(const Histogram histogram, Updater updater) : tree_(updater) {
+    uint64_t total = 0;
+    for (int s=0; s<N_SYMBOLS; s++) {
+        total += histogram[s];
+    }
+
+    // every byte seen keeps at least count 1
+    uint64_t counts[N_SYMBOLS];
+    for (int s=0; s<N_SYMBOLS; s++) {
+        counts[s] = histogram[s] ? std::max<uint64_t>(1, histogram[s] * TRAINING_WEIGHT / total) : 0;
+    }
+
+    // interleaved, as if the bytes were spread over the sample
+    bool left = true;
+    while (left) {
+        left = false;
+        for (int s=0; s<N_SYMBOLS; s++) {
+            if (counts[s]) {
+                tree_.update(s);
+                left |= --counts[s] > 0;
+            }
+        }
+    }
+
+    set_state();
+}
+
+Dictionary::Dictionary(io::Source& source) {
+    std::string file;
+    std::string storage;
+    const char* data;
+    size_t size;
+    while ((size = source.read(data, 1 << 16, storage)) > 0) {
+        file.append(data, size);
+    }
+
+    if (file.size() < 4 || !std::equal(MAGIC, MAGIC + 4, file.data())) {
+        throw std::runtime_error("not a dictionary");
+    }
+    if (file.size() < FILE_HEADER_SIZE + FILE_TRAILER_SIZE || (uint8_t)file[4] != VERSION) {
+        throw std::runtime_error("unsupported dictionary version");
+    }
+
+    uint32_t state_size = get_u32(&file[5]);
+    if (state_size != file.size() - FILE_HEADER_SIZE - FILE_TRAILER_SIZE) {
+        throw std::runtime_error("corrupt dictionary (size)");
+    }
+
+    const char* state = file.data() + FILE_HEADER_SIZE;
+    if (container::adler32(state, state_size) != get_u32(state + state_size)) {
+        throw std::runtime_error("corrupt dictionary (checksum)");
+    }
+
+    tree_.load(state, state_size);
+    set_state();
+}
+
+void Dictionary::save(io::Sink& sink) const {
+    char header[FILE_HEADER_SIZE];
+    std::copy(MAGIC, MAGIC + 4, header);
+    header[4] = VERSION;
+    put_u32(header + 5, state_.size());
+
+    char trailer[FILE_TRAILER_SIZE];
+    put_u32(trailer, container::adler32(state_.data(), state_.size()));
+
+    sink.write(header, FILE_HEADER_SIZE);
+    sink.write(state_.data(), state_.size());
+    sink.write(trailer, FILE_TRAILER_SIZE);
+    sink.flush();
+}
+
+
+void check_dictionary(const container::Header& header, const Dictionary* dictionary) {
+    if (!(header.flags & container::FLAG_DICTIONARY)) {
+        return;
+    }
+
+    if (!dictionary) {
+        throw std::runtime_error("stream was packed with a dictionary (use --dict)");
+    }
+
+    Updater updater = header.flags & container::FLAG_VITTER ? VITTER : FGK;
+    if (header.dictionary_id != dictionary->get_id() || updater != dictionary->get_updater()) {
+        throw std::runtime_error("wrong dictionary");
+    }
+}
+
+} // end namespace
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "hufftree.hpp"
+#include "canonical.hpp"
+#include "container.hpp"
+#include "io.hpp"
+
+namespace hf {
+
+/*
+ * Pre-trained model (--train, --dict)
+ * Tree state both sides start from instead of NYT only, so small
+ * messages don't pay for transferring every byte. Starting from it
+ * is a copy of the tree arrays (HuffTree::assign).
+ *
+ *   file: magic "HUFD", version u8, state_size u32,
+ *         tree state (native layout), Adler-32 of the state u32
+ *
+ * Streams packed with a dictionary carry its id in the header,
+ * unpacking needs the same file.
+ */
+class Dictionary {
+
+    detail::HuffTree tree_;
+    std::string state_;
+    uint16_t id_;
+
+    void set_state();
+
+public:
+    // counts are scaled to TRAINING_WEIGHT, so the model still adapts
+    static const uint64_t TRAINING_WEIGHT = 4096;
+
+    Dictionary(const detail::Histogram histogram, detail::Updater updater);
+    // throws std::runtime_error if it's not a valid dictionary
+    Dictionary(io::Source& source);
+
+    void save(io::Sink& sink) const;
+
+    const detail::HuffTree& get_tree() const { return tree_; }
+    detail::Updater get_updater() const { return tree_.get_updater(); }
+    uint16_t get_id() const { return id_; }
+};
+
+/*
+ * Throws std::runtime_error if the stream was packed with
+ * a dictionary and the given one (may be null) isn't it
+ */
+void check_dictionary(const container::Header& header, const Dictionary* dictionary);
+
+} // end namespace
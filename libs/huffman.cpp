@@ -1,10 +1,14 @@
 #include "huffman.hpp"
 
-#include "bitarray.hpp"
-
 #include "huffnode.hpp"
+#include "hufftree.hpp"
+#include "pipeline.hpp"
+#include "stats.hpp"
 using namespace detail;
 
+#include <algorithm>
+#include <stdexcept>
+
 #include <iostream>
 using std::cout;
 using std::endl;
@@ -14,23 +18,127 @@ using namespace std::chrono;
 
 namespace hf {
 
-Huffman::Huffman(std::istream& src, std::ostream& dest) : src_(src), dest_(dest), bit_buffer(bitarr::Mode::INCREMENT),
-                                                          input_bytes(0), output_bytes(0) {
-    nyt = new HuffNode(NYT_SYMBOL, 0, nodes_list.create_left());
-    nodes[NYT_SYMBOL] = nyt;
+namespace {
+
+// pipeline buffers
+struct RawBuffer {
+    const char* data = nullptr;
+    size_t size = 0;
+    uint32_t checksum = 0;
+    std::string storage;
+};
+
+struct PackedBuffer {
+    uint32_t raw_size = 0;
+    uint32_t checksum = 0;
+    std::string packed;
+};
+
+struct DecodedBuffer {
+    uint32_t checksum = 0;
+    std::string raw;
+};
+
+// bytes coded between progress updates (no per-byte check)
+const size_t PROGRESS_STEP = 1 << 16;
+
+const size_t MAX_COUNT_BYTES = 5;
+
+int64_t sum_counts(const int32_t counts[256]) {
+    int64_t total = 0;
+    for (int symbol=0; symbol<256; symbol++) {
+        total += counts[symbol];
+    }
+    return total;
 }
 
-Huffman::~Huffman() {
+// halves like aging does (nonzero counts stay nonzero) until below limit
+void halve_counts(int32_t counts[256], int64_t limit) {
+    while (sum_counts(counts) >= limit) {
+        for (int symbol=0; symbol<256; symbol++) {
+            counts[symbol] = (counts[symbol] + 1) / 2;
+        }
+    }
+}
 
-    // delete HuffNodes
-    for (NodePtr node : nodes_list) {
-        delete node;
+// snapshot of leaf counts (see container.hpp)
+void write_snapshot(const int32_t counts[256], std::string& out) {
+    uint16_t symbols = 0;
+    for (int symbol=0; symbol<256; symbol++) {
+        symbols += counts[symbol] != 0;
     }
-    
-    progress_printer_ = nullptr;
+    out += (char)symbols;
+    out += (char)(symbols >> 8);
+
+    for (int symbol=0; symbol<256; symbol++) {
+        if (!counts[symbol]) {
+            continue;
+        }
+
+        out += (char)symbol;
+        // LEB128
+        uint32_t count = counts[symbol];
+        while (count >= 0x80) {
+            out += (char)(count | 0x80);
+            count >>= 7;
+        }
+        out += (char)count;
+    }
+}
+
+// returns bytes read
+size_t read_snapshot(const char* data, size_t size, int32_t counts[256]) {
+    if (size < 2) {
+        throw std::runtime_error("corrupt checkpoint");
+    }
+
+    size_t symbols = (uint8_t)data[0] | (uint8_t)data[1] << 8;
+    size_t pos = 2;
+    std::fill(counts, counts + 256, 0);
+
+    for (size_t i=0; i<symbols; i++) {
+        if (pos >= size || counts[(uint8_t)data[pos]]) {
+            throw std::runtime_error("corrupt checkpoint");
+        }
+        int32_t& count = counts[(uint8_t)data[pos++]];
+
+        uint64_t value = 0;
+        for (size_t byte=0; ; byte++) {
+            if (pos >= size || byte == MAX_COUNT_BYTES) {
+                throw std::runtime_error("corrupt checkpoint");
+            }
+
+            value |= (uint64_t)((uint8_t)data[pos] & 0x7F) << (7 * byte);
+            if (!((uint8_t)data[pos++] & 0x80)) {
+                break;
+            }
+        }
+
+        // set_counts() checks the total
+        if (value == 0 || value > INT32_MAX) {
+            throw std::runtime_error("corrupt checkpoint");
+        }
+        count = value;
+    }
+
+    return pos;
 }
 
-void Huffman::update_progress(int bytes_processed) {
+} // end namespace
+
+Huffman::Huffman(io::Source& src, io::Sink& dest, Updater updater) : src_(src), dest_(dest),
+                                                                     updater_(updater), tree(updater),
+                                                                     packed_(&packed_buf_), bit_writer(packed_),
+                                                                     input_bytes(0), output_bytes(0) { }
+
+Huffman::Huffman(std::istream& src, std::ostream& dest, Updater updater) : own_src_(new io::StreamSource(src)),
+                                                                           own_dest_(new io::StreamSink(dest)),
+                                                                           src_(*own_src_), dest_(*own_dest_),
+                                                                           updater_(updater), tree(updater),
+                                                                           packed_(&packed_buf_), bit_writer(packed_),
+                                                                           input_bytes(0), output_bytes(0) { }
+
+void Huffman::update_progress(uint64_t bytes_processed) {
     if (progress_printer_) {
         progress_printer_->progress_update(bytes_processed);
     }
@@ -56,96 +164,449 @@ void Huffman::timer_print() {
 }
 
 
-void Huffman::write_to_stream_if_possible(bool last) {
-    size_t bytes;
-    
-    if (last) {
-        // if last cells use trim bytes
-        while (bit_buffer.can_trim_byte()) {
-            uint8_t buf = bit_buffer.trim_byte();
-            dest_.put(buf);
-            output_bytes++;
-        }
+void Huffman::reset_model() {
+    if (dictionary_) {
+        tree.assign(dictionary_->get_tree());
     }
     else {
-        // trim whole cells (faster)
-        uint8_t buf[sizeof(BitCell)];
-        while (bit_buffer.can_trim_cell()) {
-            
-            bit_buffer.trim_cell_into(buf, bytes);
-            
-            for (unsigned int i=0; i<bytes; i++) {
-                dest_.put(buf[i]);
-                output_bytes++;
+        tree.reset(updater_);
+    }
+}
+
+
+void Huffman::encode_byte(uint8_t b_in) {
+        
+    NodeIndex node = tree.get_leaf(b_in);
+    if (node != NO_NODE) {
+        const Code& code = tree.get_code(node);
+        bit_writer.put_bits(code.bits, code.length);
+
+        HF_STAT_ADD(code_lengths[code.length], 1);
+        HF_STAT_MAX(max_code_length, code.length);
+        HF_STAT_ADD(bits, code.length);
+    }
+
+    else {
+        // not yet transferred
+        const Code& code = tree.get_code(tree.get_nyt());
+        bit_writer.put_bits(code.bits, code.length);
+        bit_writer.put_bits(b_in, 8);
+
+        HF_STAT_ADD(nyt_escapes, 1);
+        HF_STAT_ADD(code_lengths[code.length], 1);
+        HF_STAT_MAX(max_code_length, code.length);
+        HF_STAT_ADD(bits, code.length + 8);
+    }
+
+    HF_STAT_ADD(symbols, 1);
+
+    tree.update(b_in);
+}
+
+void Huffman::encode_frame(const char* raw, size_t raw_size, std::string& packed) {
+    packed.clear();
+    packed_buf_.set_target(&packed);
+
+    for (size_t step=0; step<raw_size; step+=PROGRESS_STEP) {
+        size_t step_end = std::min(raw_size, step + PROGRESS_STEP);
+        for (size_t i=step; i<step_end; i++) {
+            encode_byte(raw[i]);
+        }
+
+        input_bytes += step_end - step;
+        update_progress(input_bytes);
+    }
+
+    bit_writer.finish();
+    packed_.flush();
+    packed_buf_.set_target(nullptr);
+}
+
+void Huffman::encode_checkpointed(const char* raw, size_t raw_size, std::string& packed) {
+    // tree is built from the counts on both sides (halved before they grow
+    // out of range), appending codes a partial frame again from its snapshot
+    int32_t counts[256];
+    tree.get_counts(counts);
+    bool snapshot = force_checkpoint_
+                 || (checkpoint_frames_ && frames_coded_ % checkpoint_frames_ == 0)
+                 || (appendable_ && raw_size < frame_size_)
+                 || sum_counts(counts) >= checkpoint_count_limit_;
+    frames_coded_++;
+    force_checkpoint_ = false;
+
+    checkpoint_.assign(1, (char)snapshot);
+    if (snapshot) {
+        halve_counts(counts, checkpoint_count_limit_);
+        tree.set_counts(counts);
+        write_snapshot(counts, checkpoint_);
+    }
+
+    encode_frame(raw, raw_size, packed);
+    packed.insert(0, checkpoint_);
+}
+
+void Huffman::snapshot_model(std::string& model) {
+    int32_t counts[256];
+    tree.get_counts(counts);
+    model.assign(1, 1);
+    write_snapshot(counts, model);
+}
+
+size_t Huffman::load_checkpoint(const char* packed, size_t packed_size) {
+    if (packed_size == 0 || (uint8_t)packed[0] > 1) {
+        throw std::runtime_error("corrupt checkpoint");
+    }
+
+    size_t pos = 1;
+    if (packed[0]) {
+        int32_t counts[256];
+        pos += read_snapshot(packed + pos, packed_size - pos, counts);
+        tree.set_counts(counts);
+    }
+
+    return pos;
+}
+
+size_t Huffman::read_raw(const char*& raw, std::string& storage) {
+    if (resumed_raw_.empty()) {
+        return src_.read(raw, frame_size_, storage);
+    }
+
+    storage.swap(resumed_raw_);
+    resumed_raw_.clear();
+
+    std::string more_storage;
+    while (storage.size() < frame_size_) {
+        const char* more;
+        size_t size = src_.read(more, frame_size_ - storage.size(), more_storage);
+        if (size == 0) {
+            break;
+        }
+        storage.append(more, size);
+    }
+
+    raw = storage.data();
+    return storage.size();
+}
+
+void Huffman::encode_frames() {
+    std::string storage;
+    std::string packed;
+
+    while (true) {
+        const char* raw;
+        size_t raw_size;
+        {
+            HF_STAT_TIME(io_ns);
+            raw_size = read_raw(raw, storage);
+        }
+        if (raw_size == 0) {
+            break;
+        }
+
+        if (independent_) {
+            reset_model();
+        }
+
+        {
+            HF_STAT_TIME(model_ns);
+            if (seekable_ && !independent_) {
+                encode_checkpointed(raw, raw_size, packed);
             }
+            else {
+                encode_frame(raw, raw_size, packed);
+            }
+        }
+        if (seekable_) {
+            frame_offsets_.push_back(resume_offset_ + output_bytes);
+        }
+
+        {
+            HF_STAT_TIME(io_ns);
+            container::write_frame(dest_, raw, raw_size, packed);
+        }
+        output_bytes += container::FRAME_OVERHEAD + packed.size();
+
+        if (raw_size < frame_size_) {
+            break;
         }
     }
-    
 }
 
-void Huffman::expand_nyt(uint8_t b_in) {
-    // create nodes IN ORDER of increasing counts
-    ListNodePtr value_listNode = nodes_list.create_left();
-    ListNodePtr new_nyt_listNode = nodes_list.create_left();
+void Huffman::encode_frames_pipelined() {
+    bool eof = false;
+    size_t written = 0;
+
+    Pipeline<RawBuffer, PackedBuffer> pipeline;
+    pipeline.run(
+        [&](RawBuffer& in) {
+            if (eof) {
+                return false;
+            }
 
-    // make new nodes
-    NodePtr value_node = new HuffNode(b_in, 1, value_listNode);
-    nyt = nyt->expand(value_node, new_nyt_listNode);
+            HF_STAT_TIME(io_ns);
+            in.size = read_raw(in.data, in.storage);
+            eof = in.size < frame_size_;
+            in.checksum = container::adler32(in.data, in.size);
+            return in.size > 0;
+        },
+        [&](RawBuffer& in, PackedBuffer& out) {
+            if (independent_) {
+                reset_model();
+            }
 
-    nodes[NYT_SYMBOL] = nyt;
-    nodes[b_in] = value_node;
+            HF_STAT_TIME(model_ns);
+            if (seekable_ && !independent_) {
+                encode_checkpointed(in.data, in.size, out.packed);
+            }
+            else {
+                encode_frame(in.data, in.size, out.packed);
+            }
+            out.raw_size = in.size;
+            out.checksum = in.checksum;
+        },
+        [&](PackedBuffer& out) {
+            if (seekable_) {
+                frame_offsets_.push_back(resume_offset_ + output_bytes + written);
+            }
+
+            HF_STAT_TIME(io_ns);
+            container::write_frame(dest_, out.raw_size, out.packed, out.checksum);
+            written += container::FRAME_OVERHEAD + out.packed.size();
+        });
+
+    output_bytes += written;
 }
 
+uint64_t Huffman::start_stream(uint64_t length) {
+    // resumed stream has its tree and frames already
+    if (!resumed_) {
+        if (dictionary_) {
+            updater_ = dictionary_->get_updater();
+        }
+        reset_model();
 
-void Huffman::encode_byte(uint8_t b_in) {
-        
-    if (nodes.count(b_in)) {
-        NodePtr node = nodes[b_in];
-        // cout << b_in << " " << node->get_code() << endl;
+        frames_coded_ = 0;
+        frame_offsets_.clear();
+    }
 
-        bit_buffer += node->get_code();
-        node->increment();
+    // checkpoints need a model carried over, seekable streams otherwise don't
+    if (checkpoint_frames_ || appendable_) {
+        seekable_ = true;
+        independent_ = false;
+    }
+    else if (seekable_) {
+        independent_ = true;
     }
 
-    else {
-        // not yet transferred
-        // cout << "# " << nyt->get_code() << endl << b_in << " " << std::bitset<8>(b_in) << endl;
-        
-        bit_buffer += nyt->get_code();
-        bit_buffer <<= 8;
-        bit_buffer |= b_in;
-        
-        expand_nyt(b_in);
+    container::Header header;
+    header.flags = (updater_ == VITTER ? container::FLAG_VITTER : 0) |
+                   (independent_ ? container::FLAG_INDEPENDENT : 0) |
+                   (dictionary_ ? container::FLAG_DICTIONARY : 0) |
+                   (seekable_ ? container::FLAG_SEEKABLE : 0) |
+                   (get_aging() ? container::FLAG_AGING : 0);
+    header.frame_size = frame_size_;
+    // appending changes the length
+    header.length = appendable_ ? container::UNKNOWN_LENGTH : length;
+    header.dictionary_id = dictionary_ ? dictionary_->get_id() : 0;
+
+    if (!resumed_) {
+        container::write_header(dest_, header);
+        output_bytes += container::HEADER_SIZE;
+    }
+
+    return header.length;
+}
+
+void Huffman::check_flushable() const {
+    if (appendable_) {
+        throw std::invalid_argument("flush points don't work with appendable streams (--append)");
+    }
+    if (checkpoint_frames_) {
+        throw std::invalid_argument("flush points don't work with checkpoints (--checkpoints)");
+    }
+    if (seekable_) {
+        throw std::invalid_argument("flush points don't work with seekable streams (--seekable)");
+    }
+}
+
+void Huffman::code_frame(const char* raw, size_t raw_size) {
+    if (independent_) {
+        reset_model();
+    }
+
+    {
+        HF_STAT_TIME(model_ns);
+        encode_frame(raw, raw_size, pending_packed_);
+    }
+    {
+        HF_STAT_TIME(io_ns);
+        container::write_frame(dest_, raw, raw_size, pending_packed_);
+    }
+    output_bytes += container::FRAME_OVERHEAD + pending_packed_.size();
+}
+
+void Huffman::write(const char* raw, size_t raw_size) {
+    if (!header_written_) {
+        check_flushable();
+        start_stream(container::UNKNOWN_LENGTH);
+        header_written_ = true;
+    }
+
+    while (raw_size > 0) {
+        // whole frames straight from the caller's data
+        if (pending_.empty() && raw_size >= frame_size_) {
+            code_frame(raw, frame_size_);
+            raw += frame_size_;
+            raw_size -= frame_size_;
+            continue;
+        }
+
+        size_t size = std::min<size_t>(raw_size, frame_size_ - pending_.size());
+        pending_.append(raw, size);
+        raw += size;
+        raw_size -= size;
+
+        if (pending_.size() == frame_size_) {
+            code_frame(pending_.data(), pending_.size());
+            pending_.clear();
+        }
     }
 }
 
+void Huffman::flush() {
+    // short frame marks the flush point
+    if (!pending_.empty()) {
+        code_frame(pending_.data(), pending_.size());
+        pending_.clear();
+    }
+
+    dest_.flush();
+}
+
+void Huffman::finish() {
+    // even an empty stream has a header
+    write(nullptr, 0);
+    flush();
+
+    container::write_frame(dest_, nullptr, 0, "");
+    output_bytes += container::FRAME_OVERHEAD;
+    dest_.flush();
+
+    header_written_ = false;
+}
+
+void Huffman::encode_frames_flushing() {
+    std::string storage;
+    // input bytes since the last flush, the oldest of them arrived at due - flush_ms_
+    size_t unflushed = 0;
+    steady_clock::time_point due;
+
+    header_written_ = true;
+    while (true) {
+        // producer went quiet, what there is goes out
+        if (unflushed && flush_ms_) {
+            int64_t left = duration_cast<milliseconds>(due - steady_clock::now()).count();
+            if (!src_.wait(std::max<int64_t>(left, 0))) {
+                flush();
+                unflushed = 0;
+                continue;
+            }
+        }
+
+        const char* raw;
+        size_t raw_size;
+        {
+            HF_STAT_TIME(io_ns);
+            size_t size = flush_bytes_ ? std::min<size_t>(frame_size_, flush_bytes_ - unflushed) : frame_size_;
+            raw_size = src_.read_some(raw, size, storage);
+        }
+        if (raw_size == 0) {
+            break;
+        }
+
+        if (!unflushed) {
+            due = steady_clock::now() + milliseconds(flush_ms_);
+        }
+        write(raw, raw_size);
+        unflushed += raw_size;
+
+        if ((flush_bytes_ && unflushed >= flush_bytes_) || (flush_ms_ && steady_clock::now() >= due)) {
+            flush();
+            unflushed = 0;
+        }
+    }
+
+    if (!pending_.empty()) {
+        code_frame(pending_.data(), pending_.size());
+        pending_.clear();
+    }
+    header_written_ = false;
+}
+
 void Huffman::encode() {
 
     timer_start();
 
-    uint8_t b_in;
-    while (src_.get((char&)b_in)) {
-        
-        encode_byte(b_in);
-        
-        write_to_stream_if_possible(false);
-        input_bytes += 1;
+    bool flushing = flush_bytes_ || flush_ms_;
+    if (flushing) {
+        check_flushable();
+    }
 
-        if (input_bytes % bytes_per_update_ == 0) {
-            update_progress(input_bytes);
-        }
+    uint64_t length = start_stream(flushing ? container::UNKNOWN_LENGTH : src_.remaining());
+
+    if (flushing) {
+        encode_frames_flushing();
+    }
+    else if (pipeline_) {
+        encode_frames_pipelined();
+    }
+    else {
+        encode_frames();
     }
 
-    // terminating byte
-    encode_byte(0);
+    if (length == container::UNKNOWN_LENGTH) {
+        // empty frame ends the stream
+        container::write_frame(dest_, nullptr, 0, "");
+        output_bytes += container::FRAME_OVERHEAD;
+    }
+    else if (input_bytes != length) {
+        throw std::runtime_error("source size changed while packing");
+    }
+
+    if (appendable_) {
+        std::string model;
+        snapshot_model(model);
+        container::write_model(dest_, model);
+        output_bytes += model.size() + container::MODEL_TRAILER_SIZE;
+    }
+
+    if (seekable_) {
+        container::write_index(dest_, frame_offsets_);
+        output_bytes += frame_offsets_.size() * container::INDEX_ENTRY_SIZE + container::INDEX_TRAILER_SIZE;
+    }
+
+    dest_.flush();
 
-    write_to_stream_if_possible(false);
-    bit_buffer.pad_to_full_byte();
-    write_to_stream_if_possible(true);
-    
     timer_stop();
     finish_progress();
+
+    if (!verbose_) {
+        return;
+    }
         
+    if (resumed_) {
+        // output replaces the stream after resume_offset_ (partial frame coded again,
+        // model and index), so it doesn't compare with the input
+        cout << "bytes appended " << input_bytes - resumed_bytes_ << " written " << output_bytes << endl;
+        if (resumed_bytes_) {
+            cout << "bytes of the last frame coded again " << resumed_bytes_ << endl;
+        }
+        cout << "stream size " << resume_offset_ + output_bytes << endl;
+        timer_print();
+        return;
+    }
+
     cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
     cout.precision(2);
     float percent = ((float)input_bytes - output_bytes) / input_bytes * 100;
@@ -153,83 +614,276 @@ void Huffman::encode() {
     timer_print();
 }
 
+uint64_t Huffman::resume(const char* data, size_t size) {
+    io::MemorySource source(data, size);
+    container::Header header = container::read_header(source);
+    if (header.get_engine() != container::ENGINE_ADAPTIVE || !header.has_checkpoints() ||
+        header.length != container::UNKNOWN_LENGTH) {
+        throw std::runtime_error("not an appendable stream");
+    }
+
+    std::vector<uint64_t> offsets;
+    container::read_index(data, size, offsets);
+    std::string model;
+    container::read_model(data, container::index_start(size, offsets.size()), model);
+
+    // tree comes from the snapshot, the dictionary isn't needed
+    if (model.empty() || model[0] != 1) {
+        throw std::runtime_error("corrupt model");
+    }
+
+    updater_ = header.flags & container::FLAG_VITTER ? VITTER : FGK;
+    dictionary_ = nullptr;
+    set_aging(header.flags & container::FLAG_AGING);
+    reset_model();
+    frame_size_ = header.frame_size;
+
+    // frames up to the last one stay
+    container::Frame frame;
+    uint64_t keep = container::HEADER_SIZE;
+    if (!offsets.empty()) {
+        io::MemorySource last(data + offsets.back(), size - offsets.back());
+        container::read_frame(last, header, frame);
+        keep = offsets.back() + container::FRAME_OVERHEAD + frame.packed_size;
+    }
+
+    if (!offsets.empty() && frame.raw_size < frame_size_) {
+        // partial frame is coded again (with the new data) from its snapshot
+        if (!container::is_checkpoint(frame)) {
+            throw std::runtime_error("not an appendable stream (partial frame without checkpoint)");
+        }
+
+        size_t skip = load_checkpoint(frame.packed, frame.packed_size);
+        resumed_raw_.resize(frame.raw_size);
+        resumed_bytes_ = frame.raw_size;
+        decode_frame(frame.packed + skip, frame.packed_size - skip, &resumed_raw_[0], resumed_raw_.size());
+        container::check_frame(frame, resumed_raw_.data(), resumed_raw_.size());
+
+        keep = offsets.back();
+        offsets.pop_back();
+    }
+    else if (load_checkpoint(model.data(), model.size()) != model.size()) {
+        throw std::runtime_error("corrupt model");
+    }
+
+    frame_offsets_ = offsets;
+    frames_coded_ = offsets.size();
+    appendable_ = true;
+    resumed_ = true;
+    // first frame starts from the loaded counts on both sides
+    force_checkpoint_ = true;
+    resume_offset_ = keep;
+    input_bytes = 0;
+
+    return keep;
+}
+
+/*
+ * Walks bit by bit until it hits leaf
+ * (codes may be longer than the bit window, so it refills on the way)
+ */
+NodeIndex Huffman::traverse_tree(bitarr::BitReader& reader, NodeIndex node) {
+    
+    while (!tree[node].is_leaf()) {
+        reader.refill();
+        node = tree[node].go_via(reader.peek(1));
+        reader.consume(1);
+    }
+    
+    return node;
+}
+
 /*
- * Consumes all bits in bit_buffer until it hits leaf
- * the bits may run out, then it returns internal node
+ * Consumes up to TABLE_BITS at a time (using decoding tables of internal nodes),
+ * near the end of frame the reader pads with zeros, extra bits aren't consumed
  */
-NodePtr Huffman::traverse_tree(NodePtr node) {
+NodeIndex Huffman::traverse_table(bitarr::BitReader& reader, NodeIndex node) {
     
-    while (!bit_buffer.is_empty() && !node->is_leaf()) {
-        uint8_t bit = bit_buffer.trim_bit();
-        node = node->go_via(bit);
+    while (!tree[node].is_leaf()) {
+        reader.refill();
+        const DecodeTable& table = tree.get_table(node);
+        unsigned int index = reader.peek(TABLE_BITS);
+        
+        reader.consume(table.bits[index]);
+        node = table.node[index];
     }
     
     return node;
 }
 
-void Huffman::load_byte() {
+
+uint8_t Huffman::decode_byte(bitarr::BitReader& reader) {
+
+    NodeIndex node = table_decoder_ ? traverse_table(reader, HuffTree::ROOT)
+                                    : traverse_tree(reader, HuffTree::ROOT);
+
+    // node is leaf now
     uint8_t b_in;
-    if (!src_.get((char&)b_in)) {
-        throw std::runtime_error("load_byte beyond input");
+    if (tree[node].is_nyt()) {
+        // not yet transferred
+        reader.refill();
+        b_in = reader.peek(8);
+        reader.consume(8);
+    }
+    else {
+        b_in = tree[node].symbol;
     }
 
-    bit_buffer <<= 8;
-    bit_buffer |= b_in;
-        
-    input_bytes++;
-    if (input_bytes % bytes_per_update_ == 0) {
-        update_progress(input_bytes);
+    HF_STAT_ADD(symbols, 1);
+    HF_STAT_ADD(nyt_escapes, tree[node].is_nyt());
+
+    tree.update(b_in);
+    return b_in;
+}
+
+void Huffman::decode_frame(const char* packed, size_t packed_size, char* raw, size_t raw_size) {
+    bitarr::BitReader reader(packed, packed_size);
+    HF_STAT_ADD(bits, packed_size * 8);
+
+    // progress counts packed bytes
+    size_t input_start = input_bytes;
+    for (size_t step=0; step<raw_size; step+=PROGRESS_STEP) {
+        size_t step_end = std::min(raw_size, step + PROGRESS_STEP);
+        for (size_t i=step; i<step_end; i++) {
+            raw[i] = decode_byte(reader);
+        }
+
+        if (reader.overrun()) {
+            throw std::runtime_error("corrupt frame (out of bits)");
+        }
+
+        update_progress(input_start + packed_size - reader.get_bits_left() / 8);
+    }
+
+    // only padding may be left
+    if (reader.get_bits_left() >= 8) {
+        throw std::runtime_error("corrupt frame (bits left)");
     }
+
+    input_bytes += packed_size;
 }
 
+void Huffman::decode_frames(const container::Header& header) {
+    container::Frame frame;
+    std::string raw;
+    uint64_t raw_read = 0;
 
-void Huffman::decode() {
-    
-    timer_start();
-    
-    NodePtr root = nyt;
     while (true) {
-        
-        NodePtr node = root;
-        while (!node->is_leaf()) {
-            if (bit_buffer.is_empty()) {
-                load_byte();
-            }
-            
-            node = traverse_tree(node);
-        }
-                
-        // node is leaf now
-        if (node->is_nyt()) {
-            // not yet transferred
-            if (!bit_buffer.can_trim_byte()) {
-                load_byte();
-            }
-            
-            uint8_t b_in = bit_buffer.trim_byte();
-            
-            /*
-             * Received ending byte. This disalows this to be used
-             * with binary files. TODO encode number of bytes in file header
-             */
-            if (b_in == 0) {
+        {
+            HF_STAT_TIME(io_ns);
+            if (!container::read_next_frame(src_, header, frame, raw_read)) {
                 break;
             }
-            
-            dest_.put(b_in);
-            expand_nyt(b_in);
         }
-        else {
-            uint8_t b_in = node->get_symbol();
-            dest_.put(b_in);
-            node->increment();
+
+        frames_read_++;
+
+        if (header.flags & container::FLAG_INDEPENDENT) {
+            reset_model();
         }
-        
-        output_bytes++;
+
+        {
+            HF_STAT_TIME(model_ns);
+            raw.resize(frame.raw_size);
+            size_t skip = header.has_checkpoints() ? load_checkpoint(frame.packed, frame.packed_size) : 0;
+            decode_frame(frame.packed + skip, frame.packed_size - skip, &raw[0], raw.size());
+        }
+        container::check_frame(frame, raw.data(), raw.size());
+
+        {
+            HF_STAT_TIME(io_ns);
+            dest_.write(raw.data(), raw.size());
+            // flush point (or the end), data before it go out now
+            if (raw.size() < header.frame_size) {
+                dest_.flush();
+            }
+        }
+        output_bytes += raw.size();
     }
+}
+
+void Huffman::decode_frames_pipelined(const container::Header& header) {
+    uint64_t raw_read = 0;
+    size_t written = 0;
+
+    Pipeline<container::Frame, DecodedBuffer> pipeline;
+    pipeline.run(
+        [&](container::Frame& frame) {
+            HF_STAT_TIME(io_ns);
+            if (!container::read_next_frame(src_, header, frame, raw_read)) {
+                return false;
+            }
+
+            frames_read_++;
+            return true;
+        },
+        [&](container::Frame& frame, DecodedBuffer& out) {
+            if (header.flags & container::FLAG_INDEPENDENT) {
+                reset_model();
+            }
+
+            HF_STAT_TIME(model_ns);
+            out.raw.resize(frame.raw_size);
+            size_t skip = header.has_checkpoints() ? load_checkpoint(frame.packed, frame.packed_size) : 0;
+            decode_frame(frame.packed + skip, frame.packed_size - skip, &out.raw[0], out.raw.size());
+            out.checksum = frame.checksum;
+        },
+        [&](DecodedBuffer& out) {
+            container::check_frame(out.checksum, out.raw.data(), out.raw.size());
+            HF_STAT_TIME(io_ns);
+            dest_.write(out.raw.data(), out.raw.size());
+            if (out.raw.size() < header.frame_size) {
+                dest_.flush();
+            }
+            written += out.raw.size();
+        });
+
+    output_bytes += written;
+}
+
+void Huffman::decode() {
+    decode(container::read_header(src_));
+}
+
+void Huffman::decode(const container::Header& header) {
+    
+    timer_start();
+
+    if (header.get_engine() != container::ENGINE_ADAPTIVE) {
+        throw std::runtime_error("not an adaptive stream");
+    }
+
+    input_bytes += container::HEADER_SIZE;
+
+    updater_ = header.flags & container::FLAG_VITTER ? VITTER : FGK;
+    set_aging(header.flags & container::FLAG_AGING);
+    check_dictionary(header, dictionary_);
+    if (!(header.flags & container::FLAG_DICTIONARY)) {
+        dictionary_ = nullptr;
+    }
+    reset_model();
+
+    if (header.length != container::UNKNOWN_LENGTH) {
+        dest_.reserve(header.length);
+    }
+
+    frames_read_ = 0;
+    if (pipeline_) {
+        decode_frames_pipelined(header);
+    }
+    else {
+        decode_frames(header);
+    }
+
+    input_bytes += frames_read_ * container::FRAME_OVERHEAD;
+    dest_.flush();
     
     timer_stop();
     finish_progress();
+
+    if (!verbose_) {
+        return;
+    }
         
     cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
     timer_print();
@@ -1,66 +1,200 @@
 #pragma once
 
 #include <sstream>
-#include <map>
-#include <set>
+#include <memory>
+#include <vector>
 
 #include <chrono>
 
-#include "linklist.hpp"
-#include "bitarray.hpp"
+#include "bitreader.hpp"
+#include "bitwriter.hpp"
 #include "progress_printer.hpp"
+#include "container.hpp"
+#include "io.hpp"
 
 #include "huffnode.hpp"
+#include "hufftree.hpp"
+#include "dictionary.hpp"
 
 namespace hf {
 
 enum Action { ENCODE, DECODE };
 
-typedef std::map<int, detail::HuffNode*> NodeMap;
-typedef lnklist::LinkList<detail::HuffNode*> NodeList;
-typedef bitarr::BitArray<detail::BitCell> CodeBitArray;
-
 class Huffman {
 
-    std::istream& src_;
-    std::ostream& dest_;
+    // adapters when constructed over standard streams
+    std::unique_ptr<io::Source> own_src_;
+    std::unique_ptr<io::Sink> own_dest_;
+
+    io::Source& src_;
+    io::Sink& dest_;
 
     ProgressPrinter* progress_printer_ = nullptr;
-    void update_progress(int bytes_processed);
+    void update_progress(uint64_t bytes_processed);
     void finish_progress();
-    int bytes_per_update_ = 10000;
+    bool verbose_ = true;
+    bool table_decoder_ = true;
     
     std::chrono::time_point<std::chrono::steady_clock> start_, end_;
     void timer_start();
     void timer_stop();
     void timer_print();
 
-    NodeMap nodes;
-    NodeList nodes_list;
-    CodeBitArray bit_buffer;
-
-    detail::NodePtr nyt;
+    detail::Updater updater_;
+    uint32_t frame_size_ = container::DEFAULT_FRAME_SIZE;
+    bool independent_ = false;
+    bool seekable_ = false;
+    // of frames written (seekable)
+    std::vector<uint64_t> frame_offsets_;
+    // model snapshot every checkpoint_frames_ frames (0 = none)
+    size_t checkpoint_frames_ = 0;
+    size_t frames_coded_ = 0;
+    int checkpoint_count_limit_ = container::CHECKPOINT_COUNT_LIMIT;
+    std::string checkpoint_;
+    // model written after the frames, partial frames are checkpoints
+    bool appendable_ = false;
+    // continuing an appendable stream (see resume())
+    bool resumed_ = false;
+    bool force_checkpoint_ = false;
+    uint64_t resume_offset_ = 0;
+    std::string resumed_raw_;
+    size_t resumed_bytes_ = 0;
+    const Dictionary* dictionary_ = nullptr;
+
+    detail::HuffTree tree;
+
+    bool pipeline_ = false;
+
+    // flush points of encode(), 0 = none (see set_flush())
+    size_t flush_bytes_ = 0;
+    int flush_ms_ = 0;
+    // push API (write(), flush(), finish())
+    bool header_written_ = false;
+    std::string pending_;
+    std::string pending_packed_;
+    // flush points don't work with frame indexes (they need full frames)
+    void check_flushable() const;
+
+    // payload of the frame being encoded goes to the caller's string
+    io::StringBuf packed_buf_;
+    std::ostream packed_;
+    bitarr::BitWriter bit_writer;
 
     size_t input_bytes;
     size_t output_bytes;
-    void write_to_stream_if_possible(bool last);
 
-    void expand_nyt(uint8_t b_in);
-    
     void encode_byte(uint8_t b_in);
+    uint8_t decode_byte(bitarr::BitReader& reader);
+
+    // next frame of input, raw data of the resumed frame go first
+    size_t read_raw(const char*& raw, std::string& storage);
+    // encode_frame() with a checkpoint prefix (every frame of CHECKPOINTED streams)
+    void encode_checkpointed(const char* raw, size_t raw_size, std::string& packed);
+    // snapshot of the tree as it is (checkpoint prefix format)
+    void snapshot_model(std::string& model);
+    // model and header (not for a resumed stream), returns the length in the header
+    uint64_t start_stream(uint64_t length);
+    // a frame of the stream (push API and flush points)
+    void code_frame(const char* raw, size_t raw_size);
+    void encode_frames();
+    void encode_frames_pipelined();
+    void encode_frames_flushing();
+
+    // frames with data read by decoder
+    size_t frames_read_ = 0;
+    void decode_frames(const container::Header& header);
+    void decode_frames_pipelined(const container::Header& header);
     
-    detail::NodePtr traverse_tree(detail::NodePtr node);
-    void load_byte();
+    detail::NodeIndex traverse_tree(bitarr::BitReader& reader, detail::NodeIndex node);
+    detail::NodeIndex traverse_table(bitarr::BitReader& reader, detail::NodeIndex node);
 
 public:
-    Huffman(std::istream& src, std::ostream& dest);
-    ~Huffman();
+    // updater is used when encoding, decoder takes it from the header
+    Huffman(io::Source& src, io::Sink& dest, detail::Updater updater = detail::FGK);
+    Huffman(std::istream& src, std::ostream& dest, detail::Updater updater = detail::FGK);
 
     void set_progress_printer(ProgressPrinter* printer) { progress_printer_ = printer; }
-    void set_bytes_per_update(int bytes) { bytes_per_update_ = bytes; }
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    void set_table_decoder(bool enabled) { table_decoder_ = enabled; }
+    void set_frame_size(uint32_t frame_size) { frame_size_ = frame_size; }
+    // for reset_model() without decode() (frame API)
+    void set_updater(detail::Updater updater) { updater_ = updater; }
+    // count aging (AGING_COUNT_LIMIT), decoder takes it from the header
+    void set_aging(bool enabled) { tree.set_count_limit(enabled ? container::AGING_COUNT_LIMIT : 0); }
+    bool get_aging() const { return tree.get_count_limit() != 0; }
+    // every frame starts with a fresh tree
+    void set_independent(bool independent) { independent_ = independent; }
+    // independent frames with an index at the end (see SeekableReader)
+    void set_seekable(bool seekable) { seekable_ = seekable; }
+    /*
+     * Single stream with a snapshot of the model every frames frames,
+     * (CHECKPOINTED, see container.hpp), the model carries over, but
+     * decoding can start at any checkpoint (ChunkedHuffman, SeekableReader)
+     */
+    void set_checkpoints(size_t frames) { checkpoint_frames_ = frames; }
+    // counts of snapshots are halved below it (CHECKPOINT_COUNT_LIMIT, lower for tests)
+    void set_checkpoint_count_limit(int limit) { checkpoint_count_limit_ = limit; }
+    /*
+     * CHECKPOINTED stream (with or without set_checkpoints()) ending with
+     * the model (APPENDABLE, see container.hpp), so it can be continued
+     * later by resume() without coding the data again
+     */
+    void set_appendable(bool appendable) { appendable_ = appendable; }
+    /*
+     * Continues an appendable stream (the whole of it in data, size) with
+     * the source. Flags and the tree come from the stream, its last frame if
+     * not full is decoded and coded again before the source. Returns bytes
+     * of the stream to keep, encode() writes what follows them (frames,
+     * model and index). Throws std::runtime_error if it's not appendable.
+     */
+    uint64_t resume(const char* data, size_t size);
+    // reading, coding and writing on separate threads
+    void set_pipeline(bool enabled) { pipeline_ = enabled; }
+    /*
+     * encode() flushes (see flush()) after every bytes of input and once
+     * ms pass since the oldest unflushed byte (0 = never), so a consumer
+     * of a slow producer sees the data early. With either set the length
+     * isn't recorded and the pipeline isn't used, seekable streams aren't
+     * supported (std::invalid_argument).
+     */
+    void set_flush(size_t bytes, int ms) { flush_bytes_ = bytes; flush_ms_ = ms; }
+    /*
+     * Model starts from the dictionary (which has to outlive the coder),
+     * its updater is used. Decoder requires it if the stream was packed
+     * with one (and ignores it otherwise).
+     */
+    void set_dictionary(const Dictionary* dictionary) { dictionary_ = dictionary; }
+
+    /*
+     * Single frame (without frame header), the streams are not used.
+     * The tree carries over to the next frame unless reset_model() is called.
+     */
+    void reset_model();
+    void encode_frame(const char* raw, size_t raw_size, std::string& packed);
+    void decode_frame(const char* packed, size_t packed_size, char* raw, size_t raw_size);
+    /*
+     * Payload of CHECKPOINTED stream starts with a model snapshot flag,
+     * the tree is built from the snapshot (if there is one), returns the
+     * size of the prefix (codes follow), throws std::runtime_error if it's malformed
+     */
+    size_t load_checkpoint(const char* packed, size_t packed_size);
+
+    /*
+     * Push API (instead of encode(), the source isn't used). write() codes
+     * frames as they fill up, flush() codes the rest as a short frame and
+     * flushes the sink, so a flush point is a frame shorter than frame_size
+     * (the model carries over, decoders flush their output after it).
+     * finish() ends the stream. Length isn't recorded, seekable streams
+     * aren't supported (std::invalid_argument).
+     */
+    void write(const char* raw, size_t raw_size);
+    void flush();
+    void finish();
 
     void encode();
     void decode();
+    // header already read by the caller
+    void decode(const container::Header& header);
 };
 
 } // end namespace
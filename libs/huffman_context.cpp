@@ -0,0 +1,110 @@
+#include "huffman_context.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace hf {
+
+namespace {
+
+const size_t MAX_SIZE_BYTES = 10;
+
+// LEB128, returns bytes written
+size_t write_size(uint64_t size, char* out) {
+    size_t n = 0;
+    while (size >= 0x80) {
+        out[n++] = (char)(size | 0x80);
+        size >>= 7;
+    }
+    out[n++] = (char)size;
+
+    return n;
+}
+
+} // end namespace
+
+
+HuffmanContext::HuffmanContext(detail::Updater updater) : no_source_(nullptr, 0), no_sink_(no_output_),
+                                                          coder_(no_source_, no_sink_, updater) {
+    coder_.set_verbose(false);
+}
+
+void HuffmanContext::set_dictionary(const Dictionary* dictionary) {
+    coder_.set_dictionary(dictionary);
+    coder_.reset_model();
+}
+
+void HuffmanContext::encode_record(const char* raw, size_t raw_size) {
+    char size[MAX_SIZE_BYTES];
+    size_t size_bytes = write_size(raw_size, size);
+
+    // codes go after the size
+    coder_.encode_frame(raw, raw_size, scratch_);
+    scratch_.insert(0, size, size_bytes);
+}
+
+CodingStats HuffmanContext::encode(const char* raw, size_t raw_size, std::string& packed) {
+    encode_record(raw, raw_size);
+    packed.assign(scratch_);
+
+    return { raw_size, packed.size() };
+}
+
+CodingStats HuffmanContext::encode(const char* raw, size_t raw_size, char* packed, size_t capacity) {
+    encode_record(raw, raw_size);
+    if (scratch_.size() > capacity) {
+        throw std::length_error("output span too small");
+    }
+
+    std::memcpy(packed, scratch_.data(), scratch_.size());
+
+    return { raw_size, scratch_.size() };
+}
+
+
+uint64_t HuffmanContext::read_size(const char*& packed, size_t& packed_size) const {
+    uint64_t size = 0;
+
+    for (size_t i=0; i<MAX_SIZE_BYTES && i<packed_size; i++) {
+        uint8_t byte = packed[i];
+        size |= (uint64_t)(byte & 0x7F) << (7 * i);
+
+        if (!(byte & 0x80)) {
+            packed += i + 1;
+            packed_size -= i + 1;
+
+            // every byte takes at least a bit
+            if (size > packed_size * 8) {
+                throw std::runtime_error("corrupt record (size)");
+            }
+
+            return size;
+        }
+    }
+
+    throw std::runtime_error("corrupt record (size)");
+}
+
+CodingStats HuffmanContext::decode(const char* packed, size_t packed_size, std::string& raw) {
+    size_t record_size = packed_size;
+    uint64_t raw_size = read_size(packed, packed_size);
+
+    raw.resize(raw_size);
+    coder_.decode_frame(packed, packed_size, &raw[0], raw_size);
+
+    return { raw_size, record_size };
+}
+
+CodingStats HuffmanContext::decode(const char* packed, size_t packed_size, char* raw, size_t capacity) {
+    size_t record_size = packed_size;
+    uint64_t raw_size = read_size(packed, packed_size);
+    if (raw_size > capacity) {
+        throw std::length_error("output span too small");
+    }
+
+    coder_.decode_frame(packed, packed_size, raw, raw_size);
+
+    return { raw_size, record_size };
+}
+
+} // end namespace
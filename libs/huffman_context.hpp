@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "huffman.hpp"
+#include "io.hpp"
+
+namespace hf {
+
+// sizes of a single call
+struct CodingStats {
+    uint64_t raw_bytes = 0;
+    uint64_t packed_bytes = 0;
+};
+
+/*
+ * Reusable coder of small in-memory records (library API)
+ * Record is the raw size (LEB128) followed by codes padded to a byte,
+ * without container header and checksum. The model carries over to the
+ * next record on both sides until reset() is called. Growable outputs are
+ * replaced (capacity kept), spans have to be large enough (std::length_error).
+ * Once warm (tree tables built, buffers grown) coding does no heap allocation.
+ * After an exception the model is undefined, reset() before the next call.
+ */
+class HuffmanContext {
+
+    // frame API of the coder doesn't use them
+    io::MemorySource no_source_;
+    std::string no_output_;
+    io::StringSink no_sink_;
+
+    Huffman coder_;
+    std::string scratch_;
+
+    void encode_record(const char* raw, size_t raw_size);
+    // returns the raw size, moves packed past the size
+    uint64_t read_size(const char*& packed, size_t& packed_size) const;
+
+public:
+    HuffmanContext(detail::Updater updater = detail::FGK);
+
+    HuffmanContext(const HuffmanContext&) = delete;
+    HuffmanContext& operator=(const HuffmanContext&) = delete;
+
+    // initial model again (dictionary or NYT only), memory is kept
+    void reset() { coder_.reset_model(); }
+
+    // model starts from the dictionary (null for none), both sides
+    // have to use the same one, resets
+    void set_dictionary(const Dictionary* dictionary);
+    // count aging (see Huffman::set_aging), both sides the same
+    void set_aging(bool enabled) { coder_.set_aging(enabled); }
+
+    CodingStats encode(const char* raw, size_t raw_size, std::string& packed);
+    CodingStats encode(const char* raw, size_t raw_size, char* packed, size_t capacity);
+
+    CodingStats decode(const char* packed, size_t packed_size, std::string& raw);
+    CodingStats decode(const char* packed, size_t packed_size, char* raw, size_t capacity);
+
+    // raw size stored in a record (to size the output span)
+    uint64_t decoded_size(const char* packed, size_t packed_size) const { return read_size(packed, packed_size); }
+};
+
+} // end namespace
@@ -1,7 +1,7 @@
 #pragma once
 
-#include "bitarray.hpp"
-#include "linklist.hpp"
+#include <cstdint>
+#include <cstddef>
 
 namespace detail {
 
@@ -10,47 +10,85 @@ const int INTERNAL_SYMBOL = -2;
 const uint8_t BIT_LEFT = 0;
 const uint8_t BIT_RIGHT = 1;
 
-class HuffNode;
-typedef HuffNode* NodePtr;
-typedef lnklist::Node<detail::NodePtr>* ListNodePtr;
-typedef uint64_t BitCell;
+/*
+ * Tree update algorithm
+ * FGK slides a node over its successors one swap at a time,
+ * VITTER is Vitter's Algorithm V (block leaders, minimal height)
+ */
+enum Updater { FGK, VITTER };
+
+/*
+ * Nodes live in one array owned by HuffTree and are linked by 16-bit indices
+ * 256 bytes + NYT leaves, so at most 2*257-1 nodes
+ */
+typedef uint16_t NodeIndex;
+const NodeIndex NO_NODE = 0xFFFF;
+const int MAX_NODES = 2 * 257 - 1;
 
-class HuffNode {
+typedef uint64_t BitCell;
 
-    int symbol_;
-    int count_;
-    ListNodePtr listNode_;
+struct HuffNode {
+    int32_t count;
+    int16_t symbol;
 
-    NodePtr left_ = nullptr;
-    NodePtr right_ = nullptr;
-    NodePtr parent_ = nullptr;
+    NodeIndex parent;
+    NodeIndex left;
+    NodeIndex right;
 
-    bitarr::BitArray<BitCell> code_;
+    // position in order of increasing weights (implicit numbering)
+    NodeIndex rank;
 
-public:
-    HuffNode(int symbol, int count, ListNodePtr listNode);
+    // decoding table (index into HuffTree tables) or NO_NODE
+    uint16_t table;
 
-    bool is_internal() const { return symbol_== INTERNAL_SYMBOL; }
+    bool is_internal() const { return symbol == INTERNAL_SYMBOL; }
     bool is_leaf() const { return !is_internal(); }
-    bool is_nyt() const { return symbol_== NYT_SYMBOL; }
-    
-    int get_symbol() { return symbol_; }
-    NodePtr go_via(uint8_t bit);
-    
-    bitarr::BitArray<BitCell> get_code() const { return code_; }
-
-    void adjust_code_to_parent(uint8_t bit);
-    NodePtr find_successor() const;
-    void swap_with(NodePtr node);
-    void increment();
-    NodePtr expand(NodePtr value_node, ListNodePtr new_nyt_listNode);
-
-    bool operator>(const HuffNode& rhs) const;
-    bool operator<(const HuffNode& rhs) const { return rhs > *this; }
-    bool operator>=(const HuffNode& rhs) const { return !(rhs > *this); }
-    bool operator<=(const HuffNode& rhs) const { return !(rhs < *this); }
-
-    friend std::ostream& operator<<(std::ostream& os, const HuffNode& node);
+    bool is_nyt() const { return symbol == NYT_SYMBOL; }
+
+    NodeIndex go_via(uint8_t bit) const { return bit == BIT_LEFT ? left : right; }
+
+    /*
+     * Ordering by weight, internal nodes are heavier
+     * than leaves with the same count
+     */
+    int weight() const { return count * 2 + (is_internal() ? 1 : 0); }
+    bool operator>(const HuffNode& rhs) const { return weight() > rhs.weight(); }
+};
+
+static_assert(sizeof(HuffNode) == 16, "HuffNode should stay compact");
+
+/*
+ * Codes of all leaves (every byte and NYT) kept in a flat table
+ * Entry is marked dirty when the path from its leaf to the root
+ * changes and rebuilt lazily when the code is needed.
+ *
+ * Root count stays below COUNT_CEILING (see HuffTree), so the tree can't
+ * get deeper than ~42 levels (Fibonacci-like counts are needed for deep
+ * trees), codes always fit into 64 bits.
+ */
+const size_t MAX_CODE_BITS = 64;
+const int NYT_INDEX = 256;
+const int CODE_TABLE_SIZE = 257;
+
+struct Code {
+    uint64_t bits = 0;
+    uint8_t length = 0;
+    bool dirty = true;
+};
+
+/*
+ * Multi-bit decoding table of an internal node
+ * For every TABLE_BITS-bit value it holds the node reached by
+ * following these bits and the number of bits actually used
+ * (walk stops early on leaves).
+ */
+const int TABLE_BITS = 6;
+const int TABLE_SIZE = 1 << TABLE_BITS;
+
+struct DecodeTable {
+    bool valid = false;
+    NodeIndex node[TABLE_SIZE];
+    uint8_t bits[TABLE_SIZE];
 };
 
 } // namespace end
@@ -0,0 +1,820 @@
+#include "hufftree.hpp"
+
+#include <stdexcept>
+#include <utility>
+#include <cstring>
+#include <algorithm>
+
+#include "stats.hpp"
+
+namespace detail {
+
+HuffTree::HuffTree(Updater updater) {
+    // tables are only built for internal nodes
+    tables_.reserve(MAX_NODES / 2);
+
+    reset(updater);
+}
+
+void HuffTree::reset(Updater updater) {
+    updater_ = updater;
+    n_nodes_ = 0;
+
+    for (NodeIndex& leaf : leaves_) {
+        leaf = NO_NODE;
+    }
+
+    for (Code& code : codes_) {
+        code.dirty = true;
+    }
+
+    n_free_blocks_ = 0;
+    for (int block=MAX_NODES-1; block>=0; block--) {
+        free_blocks_[n_free_blocks_++] = block;
+    }
+
+    // keeps capacity
+    tables_.clear();
+
+    // NYT is the root
+    nyt_ = create_node(NYT_SYMBOL, 0, MAX_NODES - 1);
+    join_block(nyt_);
+}
+
+void HuffTree::assign(const HuffTree& other) {
+    updater_ = other.updater_;
+    n_nodes_ = other.n_nodes_;
+    nyt_ = other.nyt_;
+    n_free_blocks_ = other.n_free_blocks_;
+
+    std::memcpy(nodes_, other.nodes_, sizeof(HuffNode) * n_nodes_);
+    std::memcpy(order_, other.order_, sizeof(order_));
+    std::memcpy(block_, other.block_, sizeof(block_));
+    std::memcpy(blocks_, other.blocks_, sizeof(blocks_));
+    std::memcpy(free_blocks_, other.free_blocks_, sizeof(free_blocks_));
+    std::memcpy(leaves_, other.leaves_, sizeof(leaves_));
+    std::memcpy(codes_, other.codes_, sizeof(codes_));
+
+    tables_.clear();
+    for (NodeIndex i=0; i<n_nodes_; i++) {
+        nodes_[i].table = NO_NODE;
+    }
+}
+
+namespace {
+
+// scalars in front of the arrays
+struct StateHeader {
+    uint8_t updater;
+    uint8_t unused;
+    NodeIndex n_nodes;
+    NodeIndex nyt;
+    uint16_t n_free_blocks;
+};
+
+template<typename T>
+void append(std::string& out, const T* data, size_t count) {
+    out.append((const char*)data, sizeof(T) * count);
+}
+
+template<typename T>
+void take(const char*& data, const char* end, T* dest, size_t count) {
+    if ((size_t)(end - data) < sizeof(T) * count) {
+        throw std::runtime_error("corrupt tree state (truncated)");
+    }
+
+    std::memcpy(dest, data, sizeof(T) * count);
+    data += sizeof(T) * count;
+}
+
+} // end namespace
+
+void HuffTree::save(std::string& out) const {
+    StateHeader header = { (uint8_t)updater_, 0, n_nodes_, nyt_, (uint16_t)n_free_blocks_ };
+    append(out, &header, 1);
+
+    // table indices are private to this instance
+    for (NodeIndex i=0; i<n_nodes_; i++) {
+        HuffNode node = nodes_[i];
+        node.table = NO_NODE;
+        append(out, &node, 1);
+    }
+    append(out, order_, MAX_NODES);
+    append(out, block_, MAX_NODES);
+    append(out, blocks_, MAX_NODES);
+    append(out, free_blocks_, MAX_NODES);
+    append(out, leaves_, 256);
+}
+
+void HuffTree::load(const char* data, size_t size) {
+    const char* end = data + size;
+
+    StateHeader header;
+    take(data, end, &header, 1);
+
+    n_nodes_ = header.n_nodes;
+    nyt_ = header.nyt;
+    n_free_blocks_ = header.n_free_blocks;
+    if (header.updater > VITTER || n_nodes_ == 0 || n_nodes_ > MAX_NODES || nyt_ >= n_nodes_ || n_free_blocks_ > MAX_NODES) {
+        throw std::runtime_error("corrupt tree state");
+    }
+    updater_ = (Updater)header.updater;
+
+    take(data, end, nodes_, n_nodes_);
+    take(data, end, order_, MAX_NODES);
+    take(data, end, block_, MAX_NODES);
+    take(data, end, blocks_, MAX_NODES);
+    take(data, end, free_blocks_, MAX_NODES);
+    take(data, end, leaves_, 256);
+    if (data != end) {
+        throw std::runtime_error("corrupt tree state (trailing data)");
+    }
+
+    // indices first, validate() follows them
+    auto bad_link = [this](NodeIndex index) { return index != NO_NODE && index >= n_nodes_; };
+    for (NodeIndex i=0; i<n_nodes_; i++) {
+        HuffNode& node = nodes_[i];
+        node.table = NO_NODE;
+
+        // weight() doubles the count
+        bool bad = node.count < 0 || node.count > INT32_MAX / 2 || node.rank >= MAX_NODES || bad_link(node.parent)
+                || node.symbol < INTERNAL_SYMBOL || node.symbol > 255
+                || node.is_nyt() != (i == nyt_)
+                || (node.is_internal() && (node.left >= n_nodes_ || node.right >= n_nodes_))
+                || (i == ROOT) != (node.parent == NO_NODE)
+                || (updater_ == VITTER && block_[i] >= MAX_NODES);
+        if (bad) {
+            throw std::runtime_error("corrupt tree state");
+        }
+    }
+
+    // no cycles
+    for (NodeIndex i=0; i<n_nodes_; i++) {
+        NodeIndex ancestor = nodes_[i].parent;
+        for (int steps=0; ancestor != NO_NODE; steps++) {
+            if (steps == n_nodes_) {
+                throw std::runtime_error("corrupt tree state");
+            }
+            ancestor = nodes_[ancestor].parent;
+        }
+    }
+
+    for (int rank=MAX_NODES-n_nodes_; rank<MAX_NODES; rank++) {
+        if (order_[rank] >= n_nodes_) {
+            throw std::runtime_error("corrupt tree state");
+        }
+    }
+    for (int symbol=0; symbol<256; symbol++) {
+        if (bad_link(leaves_[symbol]) || (leaves_[symbol] != NO_NODE && nodes_[leaves_[symbol]].symbol != symbol)) {
+            throw std::runtime_error("corrupt tree state");
+        }
+    }
+
+    if (updater_ == VITTER) {
+        for (int block=0; block<MAX_NODES; block++) {
+            if (blocks_[block].first >= MAX_NODES || blocks_[block].last >= MAX_NODES) {
+                throw std::runtime_error("corrupt tree state");
+            }
+        }
+        for (int i=0; i<n_free_blocks_; i++) {
+            if (free_blocks_[i] >= MAX_NODES) {
+                throw std::runtime_error("corrupt tree state");
+            }
+        }
+    }
+
+    try {
+        validate();
+    }
+    catch (const std::logic_error& e) {
+        throw std::runtime_error(std::string("corrupt tree state (") + e.what() + ")");
+    }
+
+    for (Code& code : codes_) {
+        code.dirty = true;
+    }
+    tables_.clear();
+}
+
+NodeIndex HuffTree::create_node(int symbol, int count, NodeIndex rank) {
+    NodeIndex index = n_nodes_++;
+
+    HuffNode& node = nodes_[index];
+    node.count = count;
+    node.symbol = symbol;
+    node.parent = NO_NODE;
+    node.left = NO_NODE;
+    node.right = NO_NODE;
+    node.rank = rank;
+    node.table = NO_NODE;
+
+    order_[rank] = index;
+
+    return index;
+}
+
+NodeIndex HuffTree::find_successor(NodeIndex node) const {
+    NodeIndex rank = nodes_[node].rank;
+    if (rank + 1 < MAX_NODES) {
+        return order_[rank + 1];
+    }
+
+    return NO_NODE;
+}
+
+/*
+ * Swaps subtrees of a and b (never parent and child)
+ * together with their positions in order_
+ */
+void HuffTree::swap(NodeIndex a, NodeIndex b) {
+    HuffNode& node_a = nodes_[a];
+    HuffNode& node_b = nodes_[b];
+    HuffNode& parent_a = nodes_[node_a.parent];
+    HuffNode& parent_b = nodes_[node_b.parent];
+
+    bool a_is_left = parent_a.left == a;
+    bool b_is_left = parent_b.left == b;
+
+    if (a_is_left) {
+        parent_a.left = b;
+    } else {
+        parent_a.right = b;
+    }
+
+    if (b_is_left) {
+        parent_b.left = a;
+    } else {
+        parent_b.right = a;
+    }
+
+    using std::swap;
+
+    swap(node_a.parent, node_b.parent);
+    swap(order_[node_a.rank], order_[node_b.rank]);
+    swap(node_a.rank, node_b.rank);
+    HF_STAT_ADD(swaps, 1);
+
+    invalidate_codes(a);
+    invalidate_codes(b);
+    invalidate_tables(a);
+    invalidate_tables(b);
+}
+
+void HuffTree::update(uint8_t symbol) {
+    if (updater_ == VITTER) {
+        vitter_update(symbol);
+    }
+    else if (leaves_[symbol] == NO_NODE) {
+        expand_nyt(symbol);
+    }
+    else {
+        increment(leaves_[symbol]);
+    }
+
+    if (nodes_[ROOT].count >= (count_limit_ ? count_limit_ : COUNT_CEILING)) {
+        rescale();
+    }
+}
+
+void HuffTree::set_count_limit(int limit) {
+    if (limit != 0 && (limit < MIN_COUNT_LIMIT || limit > MAX_COUNT_LIMIT)) {
+        throw std::invalid_argument("count limit out of range");
+    }
+
+    count_limit_ = limit;
+}
+
+void HuffTree::rescale() {
+    int32_t counts[256];
+    get_counts(counts);
+    for (int32_t& count : counts) {
+        count = (count + 1) / 2;
+    }
+
+    build(counts);
+    HF_STAT_ADD(rescales, 1);
+}
+
+void HuffTree::get_counts(int32_t counts[256]) const {
+    for (int symbol=0; symbol<256; symbol++) {
+        counts[symbol] = leaves_[symbol] == NO_NODE ? 0 : nodes_[leaves_[symbol]].count;
+    }
+}
+
+void HuffTree::set_counts(const int32_t counts[256]) {
+    int64_t total = 0;
+    for (int symbol=0; symbol<256; symbol++) {
+        total += counts[symbol];
+        if (counts[symbol] < 0 || total > INT32_MAX / 2) {
+            throw std::runtime_error("corrupt model counts");
+        }
+    }
+
+    build(counts);
+}
+
+/*
+ * Merges the two lightest nodes until one is left (leaves first on ties,
+ * NYT is the lightest), merge order gives the ranks. Siblings get adjacent
+ * ranks and nodes stay ordered by weight(), which is what both updaters
+ * keep. Depends only on the counts, so the decoder builds the same tree.
+ */
+void HuffTree::build(const int32_t counts[256]) {
+    struct Merged {
+        int32_t count;
+        int16_t symbol;
+        NodeIndex left;
+        NodeIndex right;
+    };
+
+    Merged merged[MAX_NODES];
+    int n = 0;
+    merged[n++] = { 0, NYT_SYMBOL, NO_NODE, NO_NODE };
+
+    for (int symbol=0; symbol<256; symbol++) {
+        if (counts[symbol]) {
+            merged[n++] = { counts[symbol], (int16_t)symbol, NO_NODE, NO_NODE };
+        }
+    }
+
+    // by count, then symbol
+    std::sort(merged + 1, merged + n, [](const Merged& a, const Merged& b) {
+        return a.count != b.count ? a.count < b.count : a.symbol < b.symbol;
+    });
+
+    // two queues, merged nodes come out in increasing counts
+    int n_leaves = n;
+    int leaf = 0;
+    int internal = n_leaves;
+    NodeIndex removed[MAX_NODES];
+    int n_removed = 0;
+
+    auto take = [&]() {
+        bool from_leaf = leaf < n_leaves && (internal == n || merged[leaf].count <= merged[internal].count);
+        int taken = from_leaf ? leaf++ : internal++;
+        removed[n_removed++] = taken;
+        return taken;
+    };
+
+    while (n - n_removed > 1) {
+        int left = take();
+        int right = take();
+        merged[n++] = { merged[left].count + merged[right].count, INTERNAL_SYMBOL, (NodeIndex)left, (NodeIndex)right };
+    }
+    take();
+
+    // k-th removed gets k-th lowest rank, root ends up at index 0
+    NodeIndex index_of[MAX_NODES];
+    for (int k=0; k<n; k++) {
+        index_of[removed[k]] = n - 1 - k;
+    }
+
+    n_nodes_ = n;
+    for (NodeIndex& leaf_index : leaves_) {
+        leaf_index = NO_NODE;
+    }
+
+    for (int k=0; k<n; k++) {
+        const Merged& from = merged[removed[k]];
+        NodeIndex index = index_of[removed[k]];
+        NodeIndex rank = MAX_NODES - n + k;
+
+        HuffNode& node = nodes_[index];
+        node.count = from.count;
+        node.symbol = from.symbol;
+        node.parent = NO_NODE;
+        node.left = from.left == NO_NODE ? NO_NODE : index_of[from.left];
+        node.right = from.right == NO_NODE ? NO_NODE : index_of[from.right];
+        node.rank = rank;
+        node.table = NO_NODE;
+        order_[rank] = index;
+
+        if (node.is_nyt()) {
+            nyt_ = index;
+        }
+        else if (node.is_leaf()) {
+            leaves_[node.symbol] = index;
+        }
+    }
+
+    for (NodeIndex index=0; index<n_nodes_; index++) {
+        if (nodes_[index].is_internal()) {
+            nodes_[nodes_[index].left].parent = index;
+            nodes_[nodes_[index].right].parent = index;
+        }
+    }
+
+    if (updater_ == VITTER) {
+        // from the root down, join_block() looks at the rank above
+        n_free_blocks_ = 0;
+        for (int block=MAX_NODES-1; block>=0; block--) {
+            free_blocks_[n_free_blocks_++] = block;
+        }
+
+        for (int rank=MAX_NODES-1; rank>=MAX_NODES-n; rank--) {
+            join_block(order_[rank]);
+        }
+    }
+
+    for (Code& code : codes_) {
+        code.dirty = true;
+    }
+    tables_.clear();
+}
+
+/*
+ * NYT becomes an internal node with new NYT as the left child
+ * and new leaf as the right one, returns the old NYT
+ */
+NodeIndex HuffTree::split_nyt(uint8_t symbol, int count) {
+    NodeIndex old_nyt = nyt_;
+    NodeIndex rank = nodes_[old_nyt].rank;
+
+    // create nodes IN ORDER of increasing counts
+    NodeIndex leaf = create_node(symbol, count, rank - 1);
+    nyt_ = create_node(NYT_SYMBOL, 0, rank - 2);
+
+    HuffNode& node = nodes_[old_nyt];
+    node.symbol = INTERNAL_SYMBOL;
+    node.left = nyt_;
+    node.right = leaf;
+    nodes_[nyt_].parent = old_nyt;
+    nodes_[leaf].parent = old_nyt;
+
+    leaves_[symbol] = leaf;
+
+    invalidate_codes(old_nyt);
+    invalidate_tables(old_nyt);
+
+    return old_nyt;
+}
+
+
+/*
+ * FGK
+ */
+void HuffTree::increment(NodeIndex index) {
+    while (index != NO_NODE) {
+        HuffNode& node = nodes_[index];
+        node.count++;
+
+        NodeIndex p_parent = node.parent;
+
+        while (true) {
+            NodeIndex next = find_successor(index);
+            if (next == NO_NODE || !(node > nodes_[next])) {
+                break;
+            }
+
+            if (next == node.parent) {
+                // check if not parent
+                // this occurs when node is sibling to NYT
+                // break the loop, parent's value is going to be incremented
+                break;
+            }
+
+            // slide node while it's not greater than it's successor
+            // excluding parent - child swap
+            swap(index, next);
+        }
+
+        if (node.is_internal()) {
+            // internal node skips all nodes that counts are equal
+            // so it swapped with same-valued node
+            // need to increment old path
+            // p_parent because parents are swapped
+            index = p_parent;
+        }
+        else {
+            // leaf node doesn't skip same valued nodes
+            // so it swapped with lower-valued node
+            // need to increment new path
+            index = node.parent;
+        }
+    }
+}
+
+void HuffTree::expand_nyt(uint8_t symbol) {
+    NodeIndex node = split_nyt(symbol, 1);
+    increment(node);
+}
+
+
+/*
+ * VITTER
+ * Nodes are kept ordered by weight() (leaves before internal nodes
+ * of the same count), each step of the update is O(1):
+ * the node is exchanged with the leader of its block or slid over
+ * the next block by exchanging it with that block's leader.
+ */
+void HuffTree::vitter_update(uint8_t symbol) {
+    NodeIndex q = leaves_[symbol];
+    NodeIndex leaf_to_increment = NO_NODE;
+
+    if (q == NO_NODE) {
+        // NYT becomes internal node of weight 0 with
+        // two zero-weight leaves, which take over its block
+        NodeIndex block = block_[nyt_];
+
+        q = split_nyt(symbol, 0);
+        leaf_to_increment = leaves_[symbol];
+
+        blocks_[block] = { nodes_[nyt_].rank, nodes_[leaf_to_increment].rank };
+        block_[nyt_] = block;
+        block_[leaf_to_increment] = block;
+        join_block(q);
+    }
+    else {
+        NodeIndex leader = get_leader(q);
+        if (leader != q) {
+            swap(q, leader);
+        }
+
+        if (nodes_[q].parent == nodes_[nyt_].parent) {
+            // sibling of NYT has the same count as its parent,
+            // the parent is incremented first
+            leaf_to_increment = q;
+            q = nodes_[q].parent;
+        }
+    }
+
+    while (q != NO_NODE) {
+        q = slide_and_increment(q);
+    }
+
+    if (leaf_to_increment != NO_NODE) {
+        slide_and_increment(leaf_to_increment);
+    }
+}
+
+/*
+ * Increments node, returns next node to increment
+ */
+NodeIndex HuffTree::slide_and_increment(NodeIndex index) {
+    NodeIndex leader = get_leader(index);
+    if (leader != index) {
+        swap(index, leader);
+    }
+
+    HuffNode& node = nodes_[index];
+    NodeIndex former_parent = node.parent;
+    int weight = node.weight();
+
+    leave_block(index);
+
+    NodeIndex next = find_successor(index);
+    if (next != NO_NODE && nodes_[next].weight() == weight + 1) {
+        // leaf followed by internal nodes of the same count or
+        // internal node followed by leaves with count one higher:
+        // slide over the whole next block, it moves one rank down
+        Block& block = blocks_[block_[next]];
+        swap(index, order_[block.last]);
+
+        block.first--;
+        block.last--;
+    }
+
+    node.count++;
+    join_block(index);
+
+    // leaf moved to a lighter parent, internal node left it
+    return node.is_leaf() ? node.parent : former_parent;
+}
+
+/*
+ * Removes node (which has to be the leader) from its block
+ */
+void HuffTree::leave_block(NodeIndex index) {
+    NodeIndex block = block_[index];
+    if (blocks_[block].first == blocks_[block].last) {
+        free_blocks_[n_free_blocks_++] = block;
+    }
+    else {
+        blocks_[block].last--;
+    }
+}
+
+/*
+ * Puts node into the block above it if it has the same weight,
+ * otherwise into a new block (rank below is always lighter)
+ */
+void HuffTree::join_block(NodeIndex index) {
+    const HuffNode& node = nodes_[index];
+
+    NodeIndex next = find_successor(index);
+    if (next != NO_NODE && nodes_[next].weight() == node.weight()) {
+        block_[index] = block_[next];
+        blocks_[block_[index]].first = node.rank;
+        return;
+    }
+
+    NodeIndex block = free_blocks_[--n_free_blocks_];
+    blocks_[block] = { node.rank, node.rank };
+    block_[index] = block;
+}
+
+
+const Code& HuffTree::get_code(NodeIndex leaf) {
+    Code& code = codes_[code_index(nodes_[leaf].symbol)];
+    if (code.dirty) {
+        code = build_code(leaf);
+        HF_STAT_ADD(code_builds, 1);
+        HF_STAT_ADD(code_build_visits, code.length);
+    }
+
+    return code;
+}
+
+/*
+ * Walks up to the root, cost is proportional to the code length
+ */
+Code HuffTree::build_code(NodeIndex leaf) const {
+    Code code;
+    code.dirty = false;
+
+    NodeIndex index = leaf;
+    while (nodes_[index].parent != NO_NODE) {
+        if (code.length == MAX_CODE_BITS) {
+            throw std::length_error("code longer than MAX_CODE_BITS");
+        }
+
+        NodeIndex parent = nodes_[index].parent;
+        uint64_t bit = nodes_[parent].left == index ? BIT_LEFT : BIT_RIGHT;
+        code.bits |= bit << code.length;
+        code.length++;
+
+        index = parent;
+    }
+
+    return code;
+}
+
+/*
+ * Paths of all leaves in this subtree changed
+ */
+void HuffTree::invalidate_codes(NodeIndex index) {
+    HF_STAT_ADD(code_invalidate_visits, 1);
+
+    const HuffNode& node = nodes_[index];
+    if (node.is_leaf()) {
+        codes_[code_index(node.symbol)].dirty = true;
+        return;
+    }
+
+    invalidate_codes(node.left);
+    invalidate_codes(node.right);
+}
+
+
+const DecodeTable& HuffTree::get_table(NodeIndex index) {
+    HuffNode& node = nodes_[index];
+    if (node.table == NO_NODE) {
+        node.table = tables_.size();
+        tables_.emplace_back();
+    }
+
+    DecodeTable& table = tables_[node.table];
+    if (!table.valid) {
+        HF_STAT_ADD(table_builds, 1);
+        fill_table(table, index, 0, 0);
+        table.valid = true;
+    }
+
+    return table;
+}
+
+/*
+ * Fills all entries starting with <depth> bits of <prefix>
+ * (walks down the subtree at most TABLE_BITS levels)
+ */
+void HuffTree::fill_table(DecodeTable& table, NodeIndex index, int depth, unsigned int prefix) const {
+    const HuffNode& node = nodes_[index];
+    if (node.is_leaf() || depth == TABLE_BITS) {
+        int free_bits = TABLE_BITS - depth;
+        unsigned int first = prefix << free_bits;
+        unsigned int last = (prefix + 1) << free_bits;
+
+        for (unsigned int i=first; i<last; i++) {
+            table.node[i] = index;
+            table.bits[i] = depth;
+        }
+
+        return;
+    }
+
+    fill_table(table, node.left, depth + 1, (prefix << 1) | BIT_LEFT);
+    fill_table(table, node.right, depth + 1, (prefix << 1) | BIT_RIGHT);
+}
+
+/*
+ * Subtree under this node changed, so tables of ancestors
+ * which reach this node (at most TABLE_BITS levels up) are outdated
+ */
+void HuffTree::invalidate_tables(NodeIndex index) {
+    NodeIndex ancestor = nodes_[index].parent;
+    for (int level=0; ancestor != NO_NODE && level<TABLE_BITS; level++) {
+        const HuffNode& node = nodes_[ancestor];
+        if (node.table != NO_NODE) {
+            tables_[node.table].valid = false;
+        }
+
+        ancestor = node.parent;
+    }
+}
+
+
+void HuffTree::validate() const {
+    NodeIndex lowest = nodes_[nyt_].rank;
+    if (lowest + n_nodes_ != MAX_NODES) {
+        throw std::logic_error("ranks not contiguous");
+    }
+
+    for (int rank=lowest; rank<MAX_NODES; rank++) {
+        NodeIndex index = order_[rank];
+        const HuffNode& node = nodes_[index];
+
+        if (node.rank != rank) {
+            throw std::logic_error("rank mismatch");
+        }
+
+        if (rank > lowest && nodes_[order_[rank - 1]].count > node.count) {
+            throw std::logic_error("nodes not ordered by count");
+        }
+
+        if (node.is_internal()) {
+            const HuffNode& left = nodes_[node.left];
+            const HuffNode& right = nodes_[node.right];
+
+            if (left.parent != index || right.parent != index) {
+                throw std::logic_error("broken parent link");
+            }
+            if (left.count + right.count != node.count) {
+                throw std::logic_error("count is not sum of children");
+            }
+        }
+        else if (!node.is_nyt() && leaves_[node.symbol] != index) {
+            throw std::logic_error("broken leaf link");
+        }
+
+        if (count_limit_ && node.is_leaf()) {
+            size_t depth = 0;
+            for (NodeIndex i=index; i!=ROOT; i=nodes_[i].parent) {
+                depth++;
+            }
+            if (depth > AGED_MAX_CODE_BITS) {
+                throw std::logic_error("code longer than AGED_MAX_CODE_BITS");
+            }
+        }
+
+        if (updater_ != VITTER) {
+            continue;
+        }
+
+        if (rank > lowest && nodes_[order_[rank - 1]].weight() > node.weight()) {
+            throw std::logic_error("nodes not ordered by weight");
+        }
+
+        const Block& block = blocks_[block_[index]];
+        if (block.first > rank || block.last < rank) {
+            throw std::logic_error("node outside of its block");
+        }
+
+        bool block_start = rank == lowest || nodes_[order_[rank - 1]].weight() != node.weight();
+        if (block_start != (block.first == rank)) {
+            throw std::logic_error("block is not maximal");
+        }
+
+        bool block_end = rank == MAX_NODES - 1 || nodes_[order_[rank + 1]].weight() != node.weight();
+        if (block_end != (block.last == rank)) {
+            throw std::logic_error("block is not maximal");
+        }
+    }
+}
+
+
+std::ostream& operator<<(std::ostream& os, const HuffTree& tree) {
+    for (int rank=tree.nodes_[tree.nyt_].rank; rank<MAX_NODES; rank++) {
+        const HuffNode& node = tree.nodes_[tree.order_[rank]];
+
+        os << "{";
+        if (node.is_nyt()) {
+            os << "NYT";
+        } else if (node.is_internal()) {
+            os << "#";
+        } else {
+            os << (char)node.symbol;
+        }
+
+        Code code = tree.build_code(tree.order_[rank]);
+        os << " code=";
+        for (int i=code.length-1; i>=0; i--) {
+            os << (int)((code.bits >> i) & 1);
+        }
+
+        os << " cnt=" << node.count << "} -> ";
+    }
+
+    return os;
+}
+
+} // end namespace
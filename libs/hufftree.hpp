@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+#include "huffnode.hpp"
+
+namespace detail {
+
+/*
+ * Count aging (optional)
+ * When the root count reaches the limit, counts of all leaves are halved
+ * (staying nonzero) and the tree is built again, so the model follows
+ * changing statistics and counts never overflow. A Huffman tree of total
+ * count below Fibonacci F(31) is at most 31 levels deep (NYT has count 0,
+ * which adds one), so with MAX_COUNT_LIMIT codes fit into 32 bits.
+ * Halving 256 leaves which are all nonzero leaves at most (limit + 256) / 2,
+ * MIN_COUNT_LIMIT makes sure this is below the limit again.
+ * Without aging counts are halved the same way when the root count reaches
+ * COUNT_CEILING, so weights (count * 2 + 1) never overflow an int.
+ */
+const int MIN_COUNT_LIMIT = 512;
+const int MAX_COUNT_LIMIT = 1 << 20;
+const size_t AGED_MAX_CODE_BITS = 32;
+const int COUNT_CEILING = 1 << 29;
+
+/*
+ * Adaptive Huffman tree
+ * All nodes are kept in one preallocated array and linked by indices,
+ * order_ holds them by increasing weight (node.rank is the position).
+ * New nodes get the lowest ranks, the root has the highest one.
+ */
+class HuffTree {
+
+    Updater updater_;
+    // 0 is no aging
+    int count_limit_ = 0;
+
+    alignas(64) HuffNode nodes_[MAX_NODES];
+    NodeIndex order_[MAX_NODES] = { };
+    NodeIndex n_nodes_ = 0;
+    NodeIndex nyt_;
+
+    /*
+     * Blocks (used by VITTER only)
+     * Block is a run of ranks holding nodes of the same weight(),
+     * its leader is the node with the highest rank.
+     */
+    struct Block {
+        NodeIndex first;
+        NodeIndex last;
+    };
+
+    // zeroed, so saved state doesn't depend on unused entries
+    NodeIndex block_[MAX_NODES] = { };
+    Block blocks_[MAX_NODES] = { };
+    NodeIndex free_blocks_[MAX_NODES] = { };
+    int n_free_blocks_ = 0;
+
+    // leaf of every byte (NO_NODE if not yet transferred)
+    NodeIndex leaves_[256];
+    Code codes_[CODE_TABLE_SIZE];
+
+    // decoding tables, allocated on first use
+    std::vector<DecodeTable> tables_;
+
+    static int code_index(int symbol) { return symbol == NYT_SYMBOL ? NYT_INDEX : symbol; }
+
+    NodeIndex create_node(int symbol, int count, NodeIndex rank);
+    NodeIndex find_successor(NodeIndex node) const;
+    void swap(NodeIndex a, NodeIndex b);
+    NodeIndex split_nyt(uint8_t symbol, int count);
+
+    // FGK
+    void increment(NodeIndex node);
+    void expand_nyt(uint8_t symbol);
+
+    // VITTER
+    void vitter_update(uint8_t symbol);
+    NodeIndex slide_and_increment(NodeIndex node);
+    NodeIndex get_leader(NodeIndex node) const { return order_[blocks_[block_[node]].last]; }
+    void leave_block(NodeIndex node);
+    void join_block(NodeIndex node);
+
+    void rescale();
+    // tree with these leaf counts (zero for symbols not transferred)
+    void build(const int32_t counts[256]);
+
+    Code build_code(NodeIndex leaf) const;
+    void invalidate_codes(NodeIndex node);
+
+    void fill_table(DecodeTable& table, NodeIndex node, int depth, unsigned int prefix) const;
+    void invalidate_tables(NodeIndex node);
+
+public:
+    static const NodeIndex ROOT = 0;
+
+    HuffTree(Updater updater = FGK);
+
+    // back to NYT only, memory is kept
+    void reset(Updater updater);
+
+    /*
+     * Model state (for dictionaries), arrays are copied as they are,
+     * decoding tables are built again when needed. State is saved in
+     * native layout, load() checks it and throws std::runtime_error.
+     */
+    void assign(const HuffTree& other);
+    void save(std::string& out) const;
+    void load(const char* data, size_t size);
+
+    const HuffNode& operator[](NodeIndex node) const { return nodes_[node]; }
+    NodeIndex get_nyt() const { return nyt_; }
+    NodeIndex get_leaf(uint8_t symbol) const { return leaves_[symbol]; }
+
+    const Code& get_code(NodeIndex leaf);
+    const DecodeTable& get_table(NodeIndex node);
+
+    Updater get_updater() const { return updater_; }
+
+    // kept over reset() and assign(), 0 disables aging (otherwise MIN..MAX_COUNT_LIMIT)
+    void set_count_limit(int limit);
+    int get_count_limit() const { return count_limit_; }
+
+    /*
+     * Model snapshot (checkpoints), counts of leaves, zero for symbols
+     * not transferred yet. set_counts() builds the tree the way aging does
+     * (so the same counts always give the same tree), throws
+     * std::runtime_error if they are out of range.
+     */
+    void get_counts(int32_t counts[256]) const;
+    void set_counts(const int32_t counts[256]);
+
+    /*
+     * Counts symbol (which was just coded), adds it to the tree
+     * if it was not yet transferred
+     */
+    void update(uint8_t symbol);
+
+    /*
+     * Checks ordering, counts, blocks and (with aging) code lengths,
+     * throws std::logic_error (for tests and debugging)
+     */
+    void validate() const;
+
+    friend std::ostream& operator<<(std::ostream& os, const HuffTree& tree);
+};
+
+} // namespace end
@@ -0,0 +1,252 @@
+#include "io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace hf {
+namespace io {
+
+namespace {
+
+std::runtime_error io_error(const std::string& path, const char* what) {
+    return std::runtime_error(path + ": " + what + ": " + std::strerror(errno));
+}
+
+} // end namespace
+
+
+FileSource::FileSource(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw io_error(path_, "can't open");
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) < 0) {
+        ::close(fd_);
+        throw io_error(path_, "can't stat");
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        // not seekable, read() it is
+        return;
+    }
+
+    size_ = st.st_size;
+    if (size_ == 0) {
+        return;
+    }
+
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        // fall back to read()
+        return;
+    }
+
+    ::madvise(map, size_, MADV_SEQUENTIAL);
+    map_ = (const char*)map;
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+FileSource::~FileSource() {
+    if (map_) {
+        ::munmap((void*)map_, size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+size_t FileSource::read(const char*& data, size_t size, std::string& storage) {
+    if (map_) {
+        size = std::min<uint64_t>(size, size_ - pos_);
+        data = map_ + pos_;
+        pos_ += size;
+        return size;
+    }
+
+    storage.resize(size);
+
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = ::read(fd_, &storage[got], size - got);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw io_error(path_, "read failed");
+        }
+        if (n == 0) {
+            break;
+        }
+
+        got += n;
+    }
+
+    pos_ += got;
+    data = storage.data();
+    return got;
+}
+
+size_t FileSource::read_some(const char*& data, size_t size, std::string& storage) {
+    if (map_) {
+        return read(data, size, storage);
+    }
+
+    storage.resize(size);
+
+    ssize_t n;
+    do {
+        n = ::read(fd_, &storage[0], size);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        throw io_error(path_, "read failed");
+    }
+
+    pos_ += n;
+    data = storage.data();
+    return n;
+}
+
+bool FileSource::wait(int timeout_ms) {
+    if (map_) {
+        return true;
+    }
+
+    // end of input and errors count as ready, read_some() reports them
+    struct pollfd fds = { fd_, POLLIN, 0 };
+    return ::poll(&fds, 1, timeout_ms) != 0;
+}
+
+
+FileSink::FileSink(const std::string& path, bool keep) : path_(path), block_(block_size_) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | (keep ? 0 : O_TRUNC), 0644);
+    if (fd_ < 0) {
+        throw io_error(path_, "can't open");
+    }
+
+    if (keep && ::lseek(fd_, 0, SEEK_END) < 0) {
+        ::close(fd_);
+        throw io_error(path_, "can't seek");
+    }
+}
+
+FileSink::~FileSink() {
+    // errors are reported only by explicit flush()
+    try {
+        flush();
+    }
+    catch (const std::runtime_error&) { }
+
+    ::close(fd_);
+}
+
+void FileSink::write_all(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw io_error(path_, "write failed");
+        }
+
+        data += n;
+        size -= n;
+    }
+}
+
+void FileSink::write(const char* data, size_t size) {
+    if (block_used_ + size > block_size_) {
+        flush();
+    }
+
+    if (size >= block_size_) {
+        write_all(data, size);
+        return;
+    }
+
+    std::memcpy(&block_[block_used_], data, size);
+    block_used_ += size;
+}
+
+void FileSink::flush() {
+    size_t used = block_used_;
+    block_used_ = 0;
+    write_all(block_.data(), used);
+}
+
+void FileSink::reserve(uint64_t size) {
+#ifdef __linux__
+    // allocate blocks up front without changing the file size,
+    // not supported everywhere (pipes, some filesystems), only a hint
+    ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, size);
+#endif
+}
+
+void FileSink::truncate(uint64_t size) {
+    flush();
+
+    if (::ftruncate(fd_, size) < 0) {
+        throw io_error(path_, "can't truncate");
+    }
+    if (::lseek(fd_, size, SEEK_SET) < 0) {
+        throw io_error(path_, "can't seek");
+    }
+}
+
+
+StreamSource::StreamSource(std::istream& is) : is_(is) {
+    std::istream::pos_type start = is_.tellg();
+    is_.seekg(0, std::ios::end);
+    std::istream::pos_type end = is_.tellg();
+    is_.clear();
+    is_.seekg(start);
+
+    if (start == std::istream::pos_type(-1) || end == std::istream::pos_type(-1)) {
+        is_.clear();
+        size_ = UNKNOWN_SIZE;
+    }
+    else {
+        size_ = end - start;
+    }
+}
+
+size_t StreamSource::read(const char*& data, size_t size, std::string& storage) {
+    storage.resize(size);
+    is_.read(&storage[0], size);
+
+    size_t got = is_.gcount();
+    pos_ += got;
+    data = storage.data();
+    return got;
+}
+
+size_t MemorySource::read(const char*& data, size_t size, std::string& storage) {
+    size_t got = std::min((uint64_t)size, size_ - pos_);
+    data = data_ + pos_;
+    pos_ += got;
+    return got;
+}
+
+StringBuf::int_type StringBuf::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        target_->push_back(traits_type::to_char_type(c));
+    }
+
+    return traits_type::not_eof(c);
+}
+
+} // end namespace
+} // end namespace
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+namespace hf {
+namespace io {
+
+const uint64_t UNKNOWN_SIZE = UINT64_MAX;
+
+/*
+ * Input of the coders
+ * Data is handed out as spans, which point straight into the source
+ * when it is memory mapped, otherwise into the storage given by the caller.
+ */
+class Source {
+public:
+    virtual ~Source() = default;
+
+    /*
+     * Next (at most) size bytes, returns how many there are
+     * (less than size only at the end of input)
+     */
+    virtual size_t read(const char*& data, size_t size, std::string& storage) = 0;
+    /*
+     * Like read(), but returns once there is some data (less than size
+     * while a pipe waits for its producer), 0 only at the end of input
+     */
+    virtual size_t read_some(const char*& data, size_t size, std::string& storage) { return read(data, size, storage); }
+    // false if nothing arrives within timeout_ms (sources which never wait return true)
+    virtual bool wait(int timeout_ms) { return true; }
+
+    // bytes left or UNKNOWN_SIZE (pipes etc.)
+    virtual uint64_t remaining() const = 0;
+};
+
+/*
+ * Output of the coders
+ */
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    virtual void write(const char* data, size_t size) = 0;
+    virtual void flush() { }
+
+    // hint, final size of the output
+    virtual void reserve(uint64_t size) { }
+};
+
+
+/*
+ * Regular files are mapped read-only (and read sequentially),
+ * other files (pipes, devices) are read with large read() calls
+ */
+class FileSource : public Source {
+
+    int fd_ = -1;
+    std::string path_;
+
+    const char* map_ = nullptr;
+    uint64_t size_ = UNKNOWN_SIZE;
+    uint64_t pos_ = 0;
+
+public:
+    FileSource(const std::string& path);
+    ~FileSource();
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    bool is_mapped() const { return map_ != nullptr; }
+
+    size_t read(const char*& data, size_t size, std::string& storage) override;
+    size_t read_some(const char*& data, size_t size, std::string& storage) override;
+    bool wait(int timeout_ms) override;
+    uint64_t remaining() const override { return size_ == UNKNOWN_SIZE ? UNKNOWN_SIZE : size_ - pos_; }
+};
+
+/*
+ * Collects small writes into a block, big ones go straight to write()
+ */
+class FileSink : public Sink {
+
+    static const size_t block_size_ = 1 << 20;
+
+    int fd_ = -1;
+    std::string path_;
+
+    std::vector<char> block_;
+    size_t block_used_ = 0;
+
+    void write_all(const char* data, size_t size);
+
+public:
+    // keep: an existing file isn't truncated, writing starts at its end
+    FileSink(const std::string& path, bool keep = false);
+    ~FileSink();
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+    void reserve(uint64_t size) override;
+    // cuts the file to size bytes, writing continues there
+    void truncate(uint64_t size);
+};
+
+
+/*
+ * Adapters for standard streams (tests, in-memory coding)
+ */
+class StreamSource : public Source {
+
+    std::istream& is_;
+    uint64_t size_;
+    uint64_t pos_ = 0;
+
+public:
+    StreamSource(std::istream& is);
+
+    size_t read(const char*& data, size_t size, std::string& storage) override;
+    uint64_t remaining() const override { return size_ == UNKNOWN_SIZE ? UNKNOWN_SIZE : size_ - pos_; }
+};
+
+/*
+ * Stream buffer appending to a string, which keeps its capacity when reused
+ */
+class StringBuf : public std::streambuf {
+
+    std::string* target_ = nullptr;
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize size) override { target_->append(data, size); return size; }
+    int_type overflow(int_type c) override;
+
+public:
+    void set_target(std::string* target) { target_ = target; }
+};
+
+class StreamSink : public Sink {
+
+    std::ostream& os_;
+
+public:
+    StreamSink(std::ostream& os) : os_(os) { }
+
+    void write(const char* data, size_t size) override { os_.write(data, size); }
+    void flush() override { os_.flush(); }
+};
+
+/*
+ * In-memory buffers, the source hands out spans of the buffer (no copies)
+ */
+class MemorySource : public Source {
+
+    const char* data_;
+    uint64_t size_;
+    uint64_t pos_ = 0;
+
+public:
+    MemorySource(const char* data, size_t size) : data_(data), size_(size) { }
+
+    size_t read(const char*& data, size_t size, std::string& storage) override;
+    uint64_t remaining() const override { return size_ - pos_; }
+};
+
+class StringSink : public Sink {
+
+    std::string& target_;
+
+public:
+    StringSink(std::string& target) : target_(target) { }
+
+    void write(const char* data, size_t size) override { target_.append(data, size); }
+    void reserve(uint64_t size) override { target_.reserve(target_.size() + size); }
+};
+
+} // end namespace
+} // end namespace
@@ -0,0 +1,39 @@
+#include "parallel.hpp"
+
+#include <thread>
+#include <vector>
+#include <exception>
+
+namespace detail {
+
+void run_parallel(size_t n_jobs, const std::function<void(size_t)>& job) {
+    if (n_jobs == 1) {
+        job(0);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(n_jobs);
+    std::vector<std::thread> workers;
+    for (size_t i=0; i<n_jobs; i++) {
+        workers.emplace_back([&, i]() {
+            try {
+                job(i);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (std::exception_ptr error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace end
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace detail {
+
+/*
+ * Runs job(0) .. job(n_jobs - 1), each on its own thread.
+ * Exception thrown by a job is rethrown when all of them finish.
+ */
+void run_parallel(size_t n_jobs, const std::function<void(size_t)>& job);
+
+} // namespace end
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+
+#include "spsc_ring.hpp"
+
+namespace detail {
+
+/*
+ * Three stage pipeline: read runs on a reader thread, code on the calling
+ * thread and write on a writer thread. Stages pass buffers by index through
+ * SPSC rings and return them to the previous stage when done, so there are
+ * no allocations once the buffers have grown.
+ *
+ *   reader --full_in--> coder --full_out--> writer
+ *          <--free_in--       <--free_out--
+ *
+ * read(In&) returns false at the end of input. An exception thrown
+ * by any stage stops the others and is rethrown from run().
+ */
+template<typename In, typename Out, size_t Depth = 4>
+class Pipeline {
+
+    // room for all the buffers and the end marker
+    typedef SpscRing<uint32_t, Depth * 2> Ring;
+    static const uint32_t END = UINT32_MAX;
+
+    In in_[Depth];
+    Out out_[Depth];
+
+    Ring free_in_, full_in_;
+    Ring free_out_, full_out_;
+
+    std::atomic<bool> abort_{false};
+
+    static void backoff(unsigned int& spins);
+    void push(Ring& ring, uint32_t index);
+    // false when the pipeline is aborted
+    bool pop(Ring& ring, uint32_t& index);
+
+public:
+    template<typename Read, typename Code, typename Write>
+    void run(Read read, Code code, Write write);
+};
+
+/*
+ * Implementations
+ */
+
+template<typename In, typename Out, size_t Depth>
+void Pipeline<In, Out, Depth>::backoff(unsigned int& spins) {
+    // short waits (other stage finishing a buffer) spin,
+    // long ones (slow disk, pipe) shouldn't burn the core
+    if (++spins < 64) {
+        std::this_thread::yield();
+    }
+    else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+template<typename In, typename Out, size_t Depth>
+void Pipeline<In, Out, Depth>::push(Ring& ring, uint32_t index) {
+    // never full, there's less indices than places
+    unsigned int spins = 0;
+    while (!ring.try_push(index)) {
+        backoff(spins);
+    }
+}
+
+template<typename In, typename Out, size_t Depth>
+bool Pipeline<In, Out, Depth>::pop(Ring& ring, uint32_t& index) {
+    unsigned int spins = 0;
+    while (!ring.try_pop(index)) {
+        if (abort_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        backoff(spins);
+    }
+
+    return true;
+}
+
+template<typename In, typename Out, size_t Depth>
+template<typename Read, typename Code, typename Write>
+void Pipeline<In, Out, Depth>::run(Read read, Code code, Write write) {
+    abort_ = false;
+    for (uint32_t i=0; i<Depth; i++) {
+        push(free_in_, i);
+        push(free_out_, i);
+    }
+
+    std::exception_ptr read_error, code_error, write_error;
+
+    std::thread reader([&]() {
+        try {
+            uint32_t i;
+            while (pop(free_in_, i)) {
+                if (!read(in_[i])) {
+                    push(full_in_, END);
+                    return;
+                }
+
+                push(full_in_, i);
+            }
+        }
+        catch (...) {
+            read_error = std::current_exception();
+            abort_ = true;
+        }
+    });
+
+    std::thread writer([&]() {
+        try {
+            uint32_t o;
+            while (pop(full_out_, o) && o != END) {
+                write(out_[o]);
+                push(free_out_, o);
+            }
+        }
+        catch (...) {
+            write_error = std::current_exception();
+            abort_ = true;
+        }
+    });
+
+    try {
+        uint32_t i, o;
+        while (pop(full_in_, i) && i != END && pop(free_out_, o)) {
+            code(in_[i], out_[o]);
+
+            push(free_in_, i);
+            push(full_out_, o);
+        }
+    }
+    catch (...) {
+        code_error = std::current_exception();
+        abort_ = true;
+    }
+
+    push(full_out_, END);
+
+    reader.join();
+    writer.join();
+
+    // drain for the next run
+    uint32_t index;
+    for (Ring* ring : { &free_in_, &full_in_, &free_out_, &full_out_ }) {
+        while (ring->try_pop(index));
+    }
+
+    for (std::exception_ptr error : { read_error, code_error, write_error }) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace end
@@ -1,8 +1,12 @@
 #include "progress_printer.hpp"
 
-#include <iostream>
-using std::cout;
-using std::endl;
+#include <cstdio>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+
+using namespace std::chrono;
 
 void showCursor(bool show) {
 #define CSI "\e["
@@ -15,38 +19,97 @@ void showCursor(bool show) {
 #undef CSI
 }
 
+namespace {
+
+const int BAR_WIDTH = 50;
+
+} // end namespace
+
+
+ProgressPrinter::ProgressPrinter(std::uintmax_t complete_size, milliseconds interval) : complete_size_(complete_size),
+                                                                                        enabled_(complete_size > 0 && isatty(STDOUT_FILENO)),
+                                                                                        interval_(interval),
+                                                                                        start_(steady_clock::now()) {
+    if (!enabled_) {
+        return;
+    }
 
-ProgressPrinter::ProgressPrinter(std::uintmax_t complete_size) : complete_size_(complete_size) {
     showCursor(false);
+    reporter_ = std::thread(&ProgressPrinter::report, this);
 }
 
 ProgressPrinter::~ProgressPrinter() {
-    showCursor(true);
+    stop();
+
+    if (enabled_) {
+        showCursor(true);
+    }
 }
 
 
-void ProgressPrinter::progress_update(int bytes_processed) {
-    percent_ = bytes_processed * 100 / complete_size_;
-    update();
+void ProgressPrinter::report() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stop_cv_.wait_for(lock, interval_, [this]() { return stop_; })) {
+        draw(processed_.load(std::memory_order_relaxed));
+    }
+}
+
+void ProgressPrinter::stop() {
+    if (!reporter_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    stop_cv_.notify_one();
+    reporter_.join();
 }
 
 void ProgressPrinter::finish() {
-  
-    if (percent_ != 100) {
-        percent_ = 100;
-        update();
+    if (!enabled_ || !reporter_.joinable()) {
+        return;
     }
-  
-    cout << endl;
+
+    stop();
+
+    draw(complete_size_);
+    fputs("\n", stdout);
     showCursor(true);
+    fflush(stdout);
 }
 
 
-void ProgressPrinter::update() {
-    cout << "\r[\u001b[32m";
-    for (int i=0; i<100; i++) {
-        if (i < percent_) cout << "#";
-        else cout << " ";
+/*
+ * Whole line is formatted first and written at once
+ */
+void ProgressPrinter::draw(std::uint64_t processed) {
+    processed = std::min<std::uint64_t>(processed, complete_size_);
+
+    int percent = processed * 100 / complete_size_;
+    int filled = processed * BAR_WIDTH / complete_size_;
+
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - start_).count();
+    double speed = seconds > 0 ? processed / seconds : 0;
+
+    std::string line = "\r[\u001b[32m";
+    line.append(filled, '#');
+    line.append(BAR_WIDTH - filled, ' ');
+    line += "\u001b[0m] ";
+
+    char stats[64];
+    if (processed < complete_size_ && speed > 0) {
+        long eta = (complete_size_ - processed) / speed + 1;
+        snprintf(stats, sizeof(stats), "%3d%% %8.2f MB/s ETA %ld:%02ld   ", percent, speed / 1e6, eta / 60, eta % 60);
     }
-    cout << "\u001b[0m] " << percent_ << "\% done";
+    else {
+        snprintf(stats, sizeof(stats), "%3d%% %8.2f MB/s              ", percent, speed / 1e6);
+    }
+    line += stats;
+
+    fputs(line.c_str(), stdout);
+    fflush(stdout);
 }
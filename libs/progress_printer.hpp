@@ -1,18 +1,44 @@
 #pragma once
 
 #include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
+/*
+ * Progress bar with throughput and ETA
+ * Coders only publish the byte count (relaxed atomic store),
+ * a reporter thread samples it at a fixed rate and redraws the line.
+ * Prints nothing when stdout is not a terminal or the size is unknown (0).
+ */
 class ProgressPrinter {
 
     std::uintmax_t complete_size_;
-    int percent_;
+    std::atomic<std::uint64_t> processed_{0};
+    bool enabled_;
 
-    void update();
+    std::chrono::milliseconds interval_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::thread reporter_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_ = false;
+
+    void report();
+    void draw(std::uint64_t processed);
+    void stop();
 
 public:
-    ProgressPrinter(std::uintmax_t complete_size);
+    ProgressPrinter(std::uintmax_t complete_size, std::chrono::milliseconds interval = std::chrono::milliseconds(100));
     ~ProgressPrinter();
 
-    void progress_update(int bytes_processed);
+    ProgressPrinter(const ProgressPrinter&) = delete;
+    ProgressPrinter& operator=(const ProgressPrinter&) = delete;
+
+    // callable from any thread, cheap enough for every frame
+    void progress_update(std::uint64_t bytes_processed) { processed_.store(bytes_processed, std::memory_order_relaxed); }
     void finish();
 };
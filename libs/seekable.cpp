@@ -0,0 +1,110 @@
+#include "seekable.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace detail;
+
+namespace hf {
+
+SeekableReader::SeekableReader(const char* data, size_t size) : data_(data), size_(size),
+                                                                no_source_(nullptr, 0), no_sink_(no_output_),
+                                                                coder_(no_source_, no_sink_) {
+    coder_.set_verbose(false);
+
+    io::MemorySource source(data, size);
+    header_ = container::read_header(source);
+
+    if (header_.get_engine() != container::ENGINE_ADAPTIVE || !(header_.flags & container::FLAG_SEEKABLE)) {
+        throw std::runtime_error("not a seekable stream (pack with --seekable)");
+    }
+
+    container::read_index(data, size, offsets_);
+
+    // all frames but the last one are full
+    uint64_t last_size = 0;
+    if (!offsets_.empty()) {
+        io::MemorySource last(data_ + offsets_.back(), size_ - offsets_.back());
+        container::Frame frame;
+        container::read_frame(last, header_, frame);
+        last_size = frame.raw_size;
+    }
+
+    length_ = offsets_.empty() ? 0 : (offsets_.size() - 1) * (uint64_t)header_.frame_size + last_size;
+    if ((!offsets_.empty() && last_size == 0) ||
+        (header_.length != container::UNKNOWN_LENGTH && header_.length != length_)) {
+        throw std::runtime_error("corrupt index (frames don't match the length)");
+    }
+}
+
+void SeekableReader::read_frame(size_t index, container::Frame& frame) const {
+    io::MemorySource source(data_ + offsets_[index], size_ - offsets_[index]);
+    container::read_frame(source, header_, frame);
+
+    uint64_t expected = std::min<uint64_t>(header_.frame_size, length_ - index * (uint64_t)header_.frame_size);
+    if (frame.raw_size != expected) {
+        throw std::runtime_error("corrupt frame header");
+    }
+}
+
+void SeekableReader::decode_frame(size_t index) {
+    bool checkpoints = header_.has_checkpoints();
+    container::Frame frame;
+
+    // checkpointed stream continues after the previous frame
+    // or starts at the nearest checkpoint
+    size_t first = index;
+    if (!checkpoints || index != next_frame_ || next_frame_ == 0) {
+        while (checkpoints && first > 0) {
+            read_frame(first, frame);
+            if (container::is_checkpoint(frame)) {
+                break;
+            }
+            first--;
+        }
+
+        bool dictionary = header_.flags & container::FLAG_DICTIONARY;
+        coder_.set_updater(header_.flags & container::FLAG_VITTER ? VITTER : FGK);
+        coder_.set_dictionary(dictionary ? dictionary_ : nullptr);
+        coder_.set_aging(header_.flags & container::FLAG_AGING);
+        coder_.reset_model();
+    }
+
+    // model is unknown if decoding fails
+    next_frame_ = 0;
+    for (size_t i=first; i<=index; i++) {
+        read_frame(i, frame);
+        size_t skip = checkpoints ? coder_.load_checkpoint(frame.packed, frame.packed_size) : 0;
+
+        frame_raw_.resize(frame.raw_size);
+        coder_.decode_frame(frame.packed + skip, frame.packed_size - skip, &frame_raw_[0], frame_raw_.size());
+        container::check_frame(frame, frame_raw_.data(), frame_raw_.size());
+
+        frames_decoded_++;
+    }
+
+    next_frame_ = index + 1;
+}
+
+void SeekableReader::read(uint64_t offset, uint64_t length, std::string& out) {
+    check_dictionary(header_, dictionary_);
+
+    if (offset >= length_ || length == 0) {
+        return;
+    }
+
+    uint64_t end = offset + std::min(length, length_ - offset);
+    uint64_t frame_size = header_.frame_size;
+
+    for (uint64_t index = offset / frame_size; index * frame_size < end; index++) {
+        decode_frame(index);
+
+        // part of the frame within the range
+        uint64_t frame_start = index * frame_size;
+        uint64_t from = std::max(offset, frame_start) - frame_start;
+        uint64_t to = std::min(end, frame_start + frame_raw_.size()) - frame_start;
+        out.append(frame_raw_, from, to - from);
+    }
+}
+
+} // end namespace
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "huffman.hpp"
+#include "container.hpp"
+#include "dictionary.hpp"
+#include "io.hpp"
+
+namespace hf {
+
+/*
+ * Random access into a SEEKABLE stream (see container.hpp)
+ * The whole stream is in memory (usually a mapped file), frame of any
+ * offset is found by the index, so reading a range decodes only the
+ * frames covering it (about one frame for short ranges). CHECKPOINTED
+ * streams are decoded from the nearest checkpoint before the range.
+ */
+class SeekableReader {
+
+    const char* data_;
+    size_t size_;
+
+    container::Header header_;
+    std::vector<uint64_t> offsets_;
+    uint64_t length_;
+
+    const Dictionary* dictionary_ = nullptr;
+
+    // frame API of the coder doesn't use them
+    io::MemorySource no_source_;
+    std::string no_output_;
+    io::StringSink no_sink_;
+
+    Huffman coder_;
+    std::string frame_raw_;
+    size_t frames_decoded_ = 0;
+    // coder's model continues with this frame (0 = it doesn't)
+    size_t next_frame_ = 0;
+
+    void read_frame(size_t index, container::Frame& frame) const;
+    void decode_frame(size_t index);
+
+public:
+    // throws std::runtime_error if it's not a valid seekable stream
+    SeekableReader(const char* data, size_t size);
+
+    SeekableReader(const SeekableReader&) = delete;
+    SeekableReader& operator=(const SeekableReader&) = delete;
+
+    // required if the stream was packed with one
+    void set_dictionary(const Dictionary* dictionary) { dictionary_ = dictionary; next_frame_ = 0; }
+
+    // of the original data
+    uint64_t get_length() const { return length_; }
+    size_t get_frames() const { return offsets_.size(); }
+    size_t get_frames_decoded() const { return frames_decoded_; }
+
+    // appends bytes [offset, offset + length) to out (clamped to the end)
+    void read(uint64_t offset, uint64_t length, std::string& out);
+};
+
+} // end namespace
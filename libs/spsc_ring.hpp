@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace detail {
+
+/*
+ * Bounded lock-free single-producer single-consumer queue
+ * One thread may only push, one other thread may only pop.
+ * Capacity has to be a power of two. Producer's and consumer's
+ * positions live on separate cache lines, each side caches
+ * the other one's position to touch its line only when needed.
+ */
+template<typename T, size_t Capacity>
+class SpscRing {
+
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+    static const size_t mask_ = Capacity - 1;
+
+    // written by consumer
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // written by producer
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+
+    alignas(64) T items_[Capacity];
+
+public:
+    static constexpr size_t get_capacity() { return Capacity; }
+
+    bool try_push(const T& item);
+    bool try_pop(T& item);
+
+    // exact only when called by producer or consumer while the other is idle
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    bool is_empty() const { return size() == 0; }
+};
+
+/*
+ * Implementations
+ */
+
+template<typename T, size_t Capacity>
+bool SpscRing<T, Capacity>::try_push(const T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - cached_head_ == Capacity) {
+        cached_head_ = head_.load(std::memory_order_acquire);
+        if (tail - cached_head_ == Capacity) {
+            return false;
+        }
+    }
+
+    items_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T, size_t Capacity>
+bool SpscRing<T, Capacity>::try_pop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    if (head == cached_tail_) {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head == cached_tail_) {
+            return false;
+        }
+    }
+
+    item = items_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+} // namespace end
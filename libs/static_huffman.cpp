@@ -0,0 +1,247 @@
+#include "static_huffman.hpp"
+
+#include <deque>
+#include <stdexcept>
+
+#include "stats.hpp"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+using namespace std::chrono;
+using namespace detail;
+
+namespace hf {
+
+namespace {
+
+// input kept between the passes
+struct RawFrame {
+    const char* data = nullptr;
+    size_t size = 0;
+    std::string storage;
+};
+
+} // end namespace
+
+
+StaticHuffman::StaticHuffman(io::Source& src, io::Sink& dest) : src_(src), dest_(dest),
+                                                                packed_(&packed_buf_), bit_writer(packed_),
+                                                                input_bytes(0), output_bytes(0) { }
+
+StaticHuffman::StaticHuffman(std::istream& src, std::ostream& dest) : own_src_(new io::StreamSource(src)),
+                                                                      own_dest_(new io::StreamSink(dest)),
+                                                                      src_(*own_src_), dest_(*own_dest_),
+                                                                      packed_(&packed_buf_), bit_writer(packed_),
+                                                                      input_bytes(0), output_bytes(0) { }
+
+void StaticHuffman::update_progress(uint64_t bytes_processed) {
+    if (progress_printer_) {
+        progress_printer_->progress_update(bytes_processed);
+    }
+}
+
+void StaticHuffman::finish_progress() {
+    if (progress_printer_) {
+        progress_printer_->finish();
+    }
+}
+
+void StaticHuffman::timer_start() {
+    start_ = steady_clock::now();
+}
+
+void StaticHuffman::timer_stop() {
+    end_ = steady_clock::now();
+}
+
+void StaticHuffman::timer_print() {
+    auto duration = duration_cast<microseconds>(end_ - start_);
+    cout << "took " << std::fixed << duration.count() / 1000000. << "s" << endl;
+}
+
+
+void StaticHuffman::encode_frame(const char* raw, size_t raw_size, std::string& packed) {
+    packed.clear();
+    packed_buf_.set_target(&packed);
+
+    const uint8_t* bytes = (const uint8_t*)raw;
+    for (size_t i=0; i<raw_size; i++) {
+        bit_writer.put_bits(encoder_.bits[bytes[i]], encoder_.length[bytes[i]]);
+        HF_STAT_ADD(code_lengths[encoder_.length[bytes[i]]], 1);
+        HF_STAT_ADD(bits, encoder_.length[bytes[i]]);
+    }
+
+    HF_STAT_ADD(symbols, raw_size);
+
+    bit_writer.finish();
+    packed_.flush();
+    packed_buf_.set_target(nullptr);
+}
+
+void StaticHuffman::encode() {
+
+    timer_start();
+
+    // first pass, mapped input isn't copied
+    std::deque<RawFrame> frames;
+    Histogram histogram = { };
+    uint64_t length = 0;
+
+    while (true) {
+        RawFrame& frame = frames.emplace_back();
+        {
+            HF_STAT_TIME(io_ns);
+            frame.size = src_.read(frame.data, frame_size_, frame.storage);
+        }
+        if (frame.size == 0) {
+            frames.pop_back();
+            break;
+        }
+
+        {
+            HF_STAT_TIME(model_ns);
+            count_bytes(frame.data, frame.size, histogram);
+        }
+        length += frame.size;
+
+        if (frame.size < frame_size_) {
+            break;
+        }
+    }
+
+    CodeLengths lengths;
+    build_lengths(histogram, MAX_CANONICAL_BITS, lengths);
+    encoder_.build(lengths);
+
+    for (int s=0; s<N_SYMBOLS; s++) {
+        HF_STAT_MAX(max_code_length, histogram[s] ? lengths[s] : 0);
+    }
+
+    container::Header header;
+    header.flags = container::ENGINE_STATIC;
+    header.frame_size = frame_size_;
+    header.length = length;
+
+    container::write_header(dest_, header);
+    container::write_lengths(dest_, lengths);
+    output_bytes += container::HEADER_SIZE + container::LENGTHS_SIZE;
+
+    // second pass
+    std::string packed;
+    for (RawFrame& frame : frames) {
+        {
+            HF_STAT_TIME(model_ns);
+            encode_frame(frame.data, frame.size, packed);
+        }
+        {
+            HF_STAT_TIME(io_ns);
+            container::write_frame(dest_, frame.data, frame.size, packed);
+        }
+
+        input_bytes += frame.size;
+        output_bytes += container::FRAME_OVERHEAD + packed.size();
+        update_progress(input_bytes);
+
+        // not needed anymore
+        std::string().swap(frame.storage);
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+
+    if (!verbose_) {
+        return;
+    }
+
+    cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
+    cout.precision(2);
+    float percent = ((float)input_bytes - output_bytes) / input_bytes * 100;
+    cout << "size reduction " << std::fixed << percent << "%" << (percent < 0 ? " (output bigger)" : "") << endl;
+    timer_print();
+}
+
+
+void StaticHuffman::decode_frame(const char* packed, size_t packed_size, char* raw, size_t raw_size) {
+    bitarr::BitReader reader(packed, packed_size);
+
+    for (size_t i=0; i<raw_size; i++) {
+        raw[i] = decoder_.decode(reader);
+    }
+
+    HF_STAT_ADD(symbols, raw_size);
+    HF_STAT_ADD(bits, packed_size * 8);
+
+    // only padding may be left
+    if (reader.overrun() || reader.get_bits_left() >= 8) {
+        throw std::runtime_error("corrupt frame (bits left)");
+    }
+}
+
+void StaticHuffman::decode() {
+    decode(container::read_header(src_));
+}
+
+void StaticHuffman::decode(const container::Header& header) {
+
+    timer_start();
+
+    if (header.get_engine() != container::ENGINE_STATIC) {
+        throw std::runtime_error("not a static stream");
+    }
+
+    CodeLengths lengths;
+    container::read_lengths(src_, lengths);
+    decoder_.build(lengths);
+    input_bytes += container::HEADER_SIZE + container::LENGTHS_SIZE;
+
+    if (header.length != container::UNKNOWN_LENGTH) {
+        dest_.reserve(header.length);
+    }
+
+    container::Frame frame;
+    std::string raw;
+    uint64_t raw_read = 0;
+
+    while (true) {
+        {
+            HF_STAT_TIME(io_ns);
+            if (!container::read_next_frame(src_, header, frame, raw_read)) {
+                break;
+            }
+        }
+
+        {
+            HF_STAT_TIME(model_ns);
+            raw.resize(frame.raw_size);
+            decode_frame(frame.packed, frame.packed_size, &raw[0], raw.size());
+        }
+        container::check_frame(frame, raw.data(), raw.size());
+
+        {
+            HF_STAT_TIME(io_ns);
+            dest_.write(raw.data(), raw.size());
+        }
+
+        input_bytes += container::FRAME_OVERHEAD + frame.packed_size;
+        output_bytes += raw.size();
+        update_progress(input_bytes);
+    }
+
+    dest_.flush();
+
+    timer_stop();
+    finish_progress();
+
+    if (!verbose_) {
+        return;
+    }
+
+    cout << "bytes input " << input_bytes << " output " << output_bytes << endl;
+    timer_print();
+}
+
+} // end namespace
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <sstream>
+#include <memory>
+
+#include <chrono>
+
+#include "bitwriter.hpp"
+#include "progress_printer.hpp"
+#include "container.hpp"
+#include "canonical.hpp"
+#include "io.hpp"
+
+namespace hf {
+
+/*
+ * Two-pass static engine
+ * First pass counts bytes of the whole input and builds length-limited
+ * canonical code, only code lengths go to the header. Second pass codes
+ * frames with a flat code table, decoder uses multi-level lookup tables.
+ * Input that isn't memory mapped is held in memory between the passes.
+ */
+class StaticHuffman {
+
+    // adapters when constructed over standard streams
+    std::unique_ptr<io::Source> own_src_;
+    std::unique_ptr<io::Sink> own_dest_;
+
+    io::Source& src_;
+    io::Sink& dest_;
+
+    ProgressPrinter* progress_printer_ = nullptr;
+    void update_progress(uint64_t bytes_processed);
+    void finish_progress();
+    bool verbose_ = true;
+
+    std::chrono::time_point<std::chrono::steady_clock> start_, end_;
+    void timer_start();
+    void timer_stop();
+    void timer_print();
+
+    uint32_t frame_size_ = container::DEFAULT_FRAME_SIZE;
+
+    detail::CanonicalEncoder encoder_;
+    detail::CanonicalDecoder decoder_;
+
+    // payload of the frame being encoded goes to the caller's string
+    io::StringBuf packed_buf_;
+    std::ostream packed_;
+    bitarr::BitWriter bit_writer;
+
+    size_t input_bytes;
+    size_t output_bytes;
+
+    void encode_frame(const char* raw, size_t raw_size, std::string& packed);
+    void decode_frame(const char* packed, size_t packed_size, char* raw, size_t raw_size);
+
+public:
+    StaticHuffman(io::Source& src, io::Sink& dest);
+    StaticHuffman(std::istream& src, std::ostream& dest);
+
+    void set_progress_printer(ProgressPrinter* printer) { progress_printer_ = printer; }
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    void set_frame_size(uint32_t frame_size) { frame_size_ = frame_size; }
+
+    void encode();
+    void decode();
+    // header already read by the caller
+    void decode(const container::Header& header);
+};
+
+} // end namespace
@@ -0,0 +1,98 @@
+#include "stats.hpp"
+
+#include <mutex>
+#include <algorithm>
+
+namespace detail {
+
+namespace {
+
+std::mutex finished_mutex;
+Stats finished;
+
+// merged into finished when its thread exits
+struct ThreadStats {
+    Stats stats;
+
+    ~ThreadStats() {
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        finished += stats;
+    }
+};
+
+thread_local ThreadStats local;
+
+} // end namespace
+
+Stats& Stats::operator+=(const Stats& other) {
+    symbols += other.symbols;
+    nyt_escapes += other.nyt_escapes;
+    swaps += other.swaps;
+    code_builds += other.code_builds;
+    code_build_visits += other.code_build_visits;
+    code_invalidate_visits += other.code_invalidate_visits;
+    table_builds += other.table_builds;
+    rescales += other.rescales;
+
+    for (size_t i=0; i<=STATS_MAX_CODE_BITS; i++) {
+        code_lengths[i] += other.code_lengths[i];
+    }
+    max_code_length = std::max(max_code_length, other.max_code_length);
+    bits += other.bits;
+
+    io_ns += other.io_ns;
+    model_ns += other.model_ns;
+
+    return *this;
+}
+
+Stats& thread_stats() {
+    return local.stats;
+}
+
+Stats collect_stats() {
+    std::lock_guard<std::mutex> lock(finished_mutex);
+    Stats total = finished;
+    total += local.stats;
+    return total;
+}
+
+bool stats_enabled() {
+#ifdef HF_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void write_stats_json(std::ostream& os, const Stats& stats) {
+    os << "{\n";
+    os << "  \"enabled\": " << (stats_enabled() ? "true" : "false") << ",\n";
+    os << "  \"symbols\": " << stats.symbols << ",\n";
+    os << "  \"nyt_escapes\": " << stats.nyt_escapes << ",\n";
+    os << "  \"swaps\": " << stats.swaps << ",\n";
+    os << "  \"code_builds\": " << stats.code_builds << ",\n";
+    os << "  \"code_build_visits\": " << stats.code_build_visits << ",\n";
+    os << "  \"code_invalidate_visits\": " << stats.code_invalidate_visits << ",\n";
+    os << "  \"table_builds\": " << stats.table_builds << ",\n";
+    os << "  \"rescales\": " << stats.rescales << ",\n";
+
+    // only lengths which occurred
+    os << "  \"code_lengths\": {";
+    bool first = true;
+    for (size_t i=0; i<=STATS_MAX_CODE_BITS; i++) {
+        if (stats.code_lengths[i]) {
+            os << (first ? "" : ", ") << "\"" << i << "\": " << stats.code_lengths[i];
+            first = false;
+        }
+    }
+    os << "},\n";
+
+    os << "  \"max_code_length\": " << stats.max_code_length << ",\n";
+    os << "  \"bits\": " << stats.bits << ",\n";
+    os << "  \"io_ns\": " << stats.io_ns << ",\n";
+    os << "  \"model_ns\": " << stats.model_ns << "\n";
+    os << "}\n";
+}
+
+} // namespace end
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <algorithm>
+#include <chrono>
+
+/*
+ * Hot path counters (--stats)
+ * Compiled in only with -DHF_STATS (make STATS=1), otherwise
+ * HF_STAT* macros expand to nothing and the coders pay nothing.
+ * Every thread counts into its own Stats, collect_stats() sums
+ * the calling thread with the threads which already finished.
+ */
+
+#ifdef HF_STATS
+#define HF_STAT_ADD(field, n) (detail::thread_stats().field += (n))
+#define HF_STAT_MAX(field, n) (detail::thread_stats().field = std::max<uint64_t>(detail::thread_stats().field, (n)))
+// adds time until the end of the scope to field (nanoseconds)
+#define HF_STAT_TIME(field) detail::StatTimer stat_timer_##field(detail::thread_stats().field)
+#else
+#define HF_STAT_ADD(field, n) ((void)0)
+#define HF_STAT_MAX(field, n) ((void)0)
+#define HF_STAT_TIME(field) ((void)0)
+#endif
+
+namespace detail {
+
+const size_t STATS_MAX_CODE_BITS = 64;
+
+struct Stats {
+    uint64_t symbols = 0;
+    // bytes sent as literals after the NYT code
+    uint64_t nyt_escapes = 0;
+
+    // adaptive tree maintenance
+    uint64_t swaps = 0;
+    uint64_t code_builds = 0;
+    uint64_t code_build_visits = 0;
+    uint64_t code_invalidate_visits = 0;
+    uint64_t table_builds = 0;
+    // count aging
+    uint64_t rescales = 0;
+
+    // code length of every coded symbol (tree depth of its leaf)
+    uint64_t code_lengths[STATS_MAX_CODE_BITS + 1] = { };
+    uint64_t max_code_length = 0;
+    // emitted by encoder, consumed by decoder (with padding)
+    uint64_t bits = 0;
+
+    uint64_t io_ns = 0;
+    uint64_t model_ns = 0;
+
+    Stats& operator+=(const Stats& other);
+};
+
+Stats& thread_stats();
+Stats collect_stats();
+
+// false when compiled without HF_STATS
+bool stats_enabled();
+
+void write_stats_json(std::ostream& os, const Stats& stats);
+
+class StatTimer {
+    uint64_t& field_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    StatTimer(uint64_t& field) : field_(field), start_(std::chrono::steady_clock::now()) { }
+    ~StatTimer() { field_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count(); }
+};
+
+} // namespace end
@@ -0,0 +1,144 @@
+#include "thread_pool.hpp"
+
+namespace detail {
+
+namespace {
+
+// set on the pool's own threads
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local unsigned int current_worker = 0;
+
+} // end namespace
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (unsigned int i=0; i<threads; i++) {
+        queues_.emplace_back(new Queue());
+    }
+
+    for (unsigned int i=0; i<threads; i++) {
+        workers_.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return pending_ == 0; });
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Job job) {
+    unsigned int queue = current_worker;
+    {
+        // counted before anyone can finish it
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_++;
+
+        if (current_pool != this) {
+            queue = next_queue_;
+            next_queue_ = (next_queue_ + 1) % queues_.size();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+        queues_[queue]->jobs.push_back(std::move(job));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_++;
+    }
+    work_cv_.notify_one();
+}
+
+bool ThreadPool::try_take(unsigned int worker, Job& job) {
+    // own newest first
+    {
+        Queue& own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    // then the oldest of others
+    for (size_t i=1; i<queues_.size(); i++) {
+        Queue& victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::work(unsigned int worker) {
+    current_pool = this;
+    current_worker = worker;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+            if (queued_ == 0) {
+                // stopping
+                return;
+            }
+
+            // reserves one job, it may be found in any queue
+            queued_--;
+        }
+
+        Job job;
+        while (!try_take(worker, job)) {
+            std::this_thread::yield();
+        }
+
+        try {
+            job(worker);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_--;
+            if (pending_ == 0) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return pending_ == 0; });
+
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace end
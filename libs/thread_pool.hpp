@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace detail {
+
+/*
+ * Work-stealing thread pool
+ * Every worker has its own queue, takes the newest job from it and when
+ * it's empty steals the oldest job of another worker. Jobs submitted by
+ * a worker go to its own queue (so a job splitting itself into smaller
+ * ones keeps them local unless others are idle), jobs submitted from
+ * outside are spread round robin. Job gets the index of its worker
+ * (for per-worker state).
+ */
+class ThreadPool {
+public:
+    typedef std::function<void(unsigned int worker)> Job;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    unsigned int next_queue_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    // jobs in queues (not yet taken) and jobs not yet finished
+    size_t queued_ = 0;
+    size_t pending_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    bool try_take(unsigned int worker, Job& job);
+    void work(unsigned int worker);
+
+public:
+    ThreadPool(unsigned int threads);
+    // waits for submitted jobs
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const { return workers_.size(); }
+
+    void submit(Job job);
+
+    /*
+     * Blocks until all jobs (including the ones they submitted) finish,
+     * rethrows the first exception thrown by a job
+     */
+    void wait();
+};
+
+} // namespace end
@@ -2,63 +2,297 @@
 using std::cout;
 using std::endl;
 
-#include <fstream>
 #include <string>
-#include <filesystem>
+#include <memory>
 
 #include "libs/huffman.hpp"
+#include "libs/chunked.hpp"
+#include "libs/static_huffman.hpp"
+#include "libs/block_huffman.hpp"
+#include "libs/dictionary.hpp"
+#include "libs/batch.hpp"
+#include "libs/seekable.hpp"
 #include "libs/CLI11_wrapper.hpp"
 #include "libs/progress_printer.hpp"
+#include "libs/io.hpp"
+#include "libs/stats.hpp"
 
 int main(int argc, char** argv) {
 
     // parse command line options using non-standard library
     // CLI11 (https://github.com/CLIUtils/CLI11)
-    std::string source_path, destination_path;
-    bool encode = false, decode = false;
-    if (parse(argc, argv, source_path, destination_path, encode, decode)) {
+    Options options;
+    if (parse(argc, argv, options)) {
         return 1;
     }
 
-    if (!encode && !decode) {
+    const std::string& source_path = options.source_path;
+    const std::string& destination_path = options.destination_path;
+    bool encode = options.encode, decode = options.decode;
+    bool train = !options.train_paths.empty();
+    bool batch = !options.batch_paths.empty();
+
+    if (!encode && !decode && !train) {
         // neither given
         cout << "no action specified, use exactly one of pack/unpack options" << endl;
         return 1;
     }
 
+    if ((!train && !batch && source_path.empty()) || destination_path.empty()) {
+        cout << "source and destination files are required (-s, -d)" << endl;
+        return 1;
+    }
+
+    if (encode && options.mode != ADAPTIVE && !options.dictionary_path.empty()) {
+        cout << "dictionaries work with adaptive mode only" << endl;
+        return 1;
+    }
+
+    if (encode && options.mode != ADAPTIVE && options.seekable) {
+        cout << "seekable streams work with adaptive mode only" << endl;
+        return 1;
+    }
+
+    if (encode && options.mode != ADAPTIVE && options.aging) {
+        cout << "aging works with adaptive mode only" << endl;
+        return 1;
+    }
+
+    if (encode && options.checkpoints && (options.mode != ADAPTIVE || options.threads > 0 || batch)) {
+        cout << "checkpoints work with a single adaptive stream only (without --threads)" << endl;
+        return 1;
+    }
+
+    if (options.append && (options.mode != ADAPTIVE || options.threads > 0 || batch)) {
+        cout << "appending works with a single adaptive stream only (without --threads)" << endl;
+        return 1;
+    }
+
+    bool flushing = options.flush_bytes > 0 || options.flush_ms > 0;
+    if (flushing && (options.mode != ADAPTIVE || options.threads > 0 || batch || options.pipeline)) {
+        cout << "flush points work with a single adaptive stream only (without --threads or --pipeline)" << endl;
+        return 1;
+    }
+
+    if (flushing && (options.seekable || options.checkpoints || options.append)) {
+        const char* option = options.append ? "--append" : options.checkpoints ? "--checkpoints" : "--seekable";
+        cout << "flush points don't work with " << option << " (frame index needs full frames)" << endl;
+        return 1;
+    }
+
     try {
-        // get file size of input
-        std::filesystem::path path(source_path);
-        std::uintmax_t source_size = std::filesystem::file_size(path);
+        if (train) {
+            cout << "training: " << options.train_paths.size() << " files --> " << destination_path << endl;
+
+            // byte counts of all samples
+            detail::Histogram histogram = { };
+            for (const std::string& path : options.train_paths) {
+                hf::io::FileSource sample(path);
+                std::string storage;
+                const char* data;
+                size_t size;
+                while ((size = sample.read(data, 1 << 20, storage)) > 0) {
+                    detail::count_bytes(data, size, histogram);
+                }
+            }
+
+            hf::Dictionary dictionary(histogram, options.updater);
+            hf::io::FileSink out(destination_path);
+            dictionary.save(out);
+
+            return 0;
+        }
+
+        // pre-trained model for both sides
+        std::unique_ptr<hf::Dictionary> dictionary;
+        if (!options.dictionary_path.empty()) {
+            hf::io::FileSource dictionary_in(options.dictionary_path);
+            dictionary.reset(new hf::Dictionary(dictionary_in));
+        }
+
+        if (batch) {
+            if (encode && options.mode != ADAPTIVE) {
+                cout << "batch mode packs with adaptive engine only" << endl;
+                return 1;
+            }
+
+            cout << (encode ? "encoding: " : "decoding: ") << options.batch_paths.size() << " inputs --> " << destination_path << endl;
+
+            // create batch coder
+            hf::Batch coder(options.threads, options.chunk_size);
+            coder.set_updater(options.updater);
+            coder.set_dictionary(dictionary.get());
+            coder.set_aging(options.aging);
+
+            // do the job
+            if (encode) {
+                coder.encode(options.batch_paths, destination_path, options.archive);
+            }
+            else if (decode) {
+                coder.decode(options.batch_paths, destination_path, options.archive);
+            }
 
-        // open file streams
-        std::fstream in, out;
-        in.open(source_path, std::ios::in | std::ios::binary);
-        out.open(destination_path, std::ios::out | std::ios::binary);
+            if (options.stats) {
+                detail::write_stats_json(std::cerr, detail::collect_stats());
+            }
+            return 0;
+        }
 
-        // create Huffman coder
-        hf::Huffman coder(in, out);
+        // open files (input is memory mapped if possible)
+        hf::io::FileSource in(source_path);
+        hf::io::FileSink out(destination_path, options.append);
 
-        // create progress printer
-        ProgressPrinter printer(source_size);
-        coder.set_progress_printer(&printer);
-        coder.set_bytes_per_update(source_size / 1000 + 1); // update every 0.1%
+        // create progress printer (size unknown for pipes, silent if stdout isn't a terminal)
+        uint64_t source_size = in.remaining();
+        bool show_progress = source_size != hf::io::UNKNOWN_SIZE && source_size > 0;
+        ProgressPrinter printer(show_progress ? source_size : 0);
 
-        // do the job
         if (encode) {
-            cout << "encoding: " << source_path << " --> " << destination_path << endl;
-            coder.encode();
+            cout << (options.append ? "appending: " : "encoding: ") << source_path << " --> " << destination_path << endl;
         }
         else if (decode) {
             cout << "decoding: " << source_path << " --> " << destination_path << endl;
-            coder.decode();
         }
 
-        // close file streams
-        in.close();
-        out.close();
+        // when decoding the engine comes from the header
+        hf::container::Header header;
+        Mode mode = options.mode;
+        if (decode && !options.range) {
+            header = hf::container::read_header(in);
+            uint8_t engine = header.get_engine();
+            mode = engine == hf::container::ENGINE_STATIC ? STATIC
+                 : engine == hf::container::ENGINE_BLOCK ? BLOCK
+                 : ADAPTIVE;
+        }
+
+        if (options.range) {
+            if (source_size == hf::io::UNKNOWN_SIZE) {
+                cout << "--range needs a regular file" << endl;
+                return 1;
+            }
+
+            // index is at the end, the whole stream is mapped
+            std::string storage;
+            const char* data;
+            size_t size = in.read(data, source_size, storage);
+
+            hf::SeekableReader reader(data, size);
+            reader.set_dictionary(dictionary.get());
+
+            // only the frames covering the range
+            std::string raw;
+            reader.read(options.range_offset, options.range_length, raw);
+            out.write(raw.data(), raw.size());
+            out.flush();
+
+            cout << "bytes output " << raw.size() << " frames decoded " << reader.get_frames_decoded() << " of " << reader.get_frames() << endl;
+        }
+        else if (mode == BLOCK) {
+            // create block coder
+            hf::BlockHuffman coder(in, out);
+            coder.set_progress_printer(show_progress ? &printer : nullptr);
+            coder.set_threads(options.threads);
+            coder.set_block_size(options.block_size);
+
+            // do the job
+            if (encode) {
+                coder.encode();
+            }
+            else if (decode) {
+                coder.decode(header);
+            }
+        }
+        else if (mode == STATIC) {
+            // create static coder
+            hf::StaticHuffman coder(in, out);
+            coder.set_progress_printer(show_progress ? &printer : nullptr);
+
+            // do the job
+            if (encode) {
+                coder.encode();
+            }
+            else if (decode) {
+                coder.decode(header);
+            }
+        }
+        else if (options.threads > 0) {
+            // create chunked coder
+            hf::ChunkedHuffman coder(in, out, options.threads, options.chunk_size);
+            coder.set_progress_printer(show_progress ? &printer : nullptr);
+            coder.set_updater(options.updater);
+            coder.set_dictionary(dictionary.get());
+            coder.set_seekable(options.seekable);
+            coder.set_aging(options.aging);
+
+            // do the job
+            if (encode) {
+                coder.encode();
+            }
+            else if (decode) {
+                coder.decode(header);
+            }
+        }
+        else {
+            // create Huffman coder
+            hf::Huffman coder(in, out, options.updater);
+            coder.set_pipeline(options.pipeline);
+            coder.set_dictionary(dictionary.get());
+            coder.set_seekable(options.seekable);
+            coder.set_aging(options.aging);
+            coder.set_checkpoints(options.checkpoints);
+            coder.set_appendable(options.append);
+            coder.set_flush(options.flush_bytes, options.flush_ms);
+
+            // existing stream is continued from its model, a new one is created,
+            // bytes after keep are put back if it fails
+            uint64_t keep = 0;
+            std::string tail;
+            if (options.append) {
+                {
+                    // unmapped before the file is cut
+                    hf::io::FileSource old(destination_path);
+                    if (old.remaining() == hf::io::UNKNOWN_SIZE) {
+                        cout << "--append needs a regular file" << endl;
+                        return 1;
+                    }
+
+                    std::string storage;
+                    const char* data;
+                    size_t size = old.read(data, old.remaining(), storage);
+                    if (size > 0) {
+                        keep = coder.resume(data, size);
+                        tail.assign(data + keep, size - keep);
+                    }
+                }
+                out.truncate(keep);
+            }
+            coder.set_progress_printer(show_progress ? &printer : nullptr);
+
+            // do the job
+            if (encode) {
+                try {
+                    coder.encode();
+                }
+                catch (...) {
+                    if (options.append) {
+                        out.truncate(keep);
+                        out.write(tail.data(), tail.size());
+                        out.flush();
+                    }
+                    throw;
+                }
+            }
+            else if (decode) {
+                coder.decode(header);
+            }
+        }
     }
-    catch (const std::filesystem::filesystem_error& e) {
+    catch (const std::exception& e) {
         cout << e.what() << endl;
+        return 1;
+    }
+
+    if (options.stats) {
+        detail::write_stats_json(std::cerr, detail::collect_stats());
     }
 }
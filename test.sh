@@ -1,12 +1,17 @@
+#!/bin/bash
+
 OUT=out.bin
 DECODED=decoded.txt
 
 FILES=$(find txt -type f | sort)
 
-for FILE in ${FILES}; do
-    # echo Trying ${FILE}
-    ./main --pack -s ${FILE} -d ${OUT} # > /dev/null
-    ./main --unpack -s ${OUT} -d ${DECODED} # > /dev/null
+# round trip with given extra options, prints OK/FAIL
+check() {
+    FILE=$1
+    shift
+
+    ./main --pack -s ${FILE} -d ${OUT} "$@" # > /dev/null
+    ./main --unpack -s ${OUT} -d ${DECODED} "$@" # > /dev/null
 
     SUM_ORIG=($(md5sum ${FILE}))
     SUM_DECODED=($(md5sum ${DECODED}))
@@ -19,4 +24,94 @@ for FILE in ${FILES}; do
 
     echo ""
     rm ${OUT} ${DECODED}
+}
+
+for FILE in ${FILES}; do
+    # echo Trying ${FILE}
+    check ${FILE}
+    check ${FILE} --threads 4 --chunk-size 65536
+    check ${FILE} --updater vitter
+    check ${FILE} --pipeline
+    check ${FILE} --mode static
+    check ${FILE} --mode block --block-size 16384 --threads 2
+    check ${FILE} --seekable --threads 4 --chunk-size 65536
+    check ${FILE} --aging --updater vitter
+    check ${FILE} --aging --threads 4 --chunk-size 65536
+done
+
+# range of a seekable stream
+FILE=txt/4-passages-head_1M.tsv
+./main --pack -s ${FILE} -d ${OUT} --seekable --threads 4 --chunk-size 65536 > /dev/null
+./main --unpack -s ${OUT} -d ${DECODED} --range 300000:150000 > /dev/null
+cmp -s ${DECODED} <(tail -c +300001 ${FILE} | head -c 150000) && echo "OK" || echo "FAIL"
+rm ${OUT} ${DECODED}
+
+# checkpointed single stream (1 MiB frames), unpacked in parallel and by range
+BIG=$(mktemp)
+for i in 1 2 3 4 5; do cat ${FILE}; done > ${BIG}
+./main --pack -s ${BIG} -d ${OUT} --checkpoints 2 > /dev/null
+./main --unpack -s ${OUT} -d ${DECODED} --threads 4 > /dev/null
+cmp -s ${DECODED} ${BIG} && echo "OK" || echo "FAIL"
+./main --unpack -s ${OUT} -d ${DECODED} > /dev/null
+cmp -s ${DECODED} ${BIG} && echo "OK" || echo "FAIL"
+./main --unpack -s ${OUT} -d ${DECODED} --range 3000000:1500000 > /dev/null
+cmp -s ${DECODED} <(tail -c +3000001 ${BIG} | head -c 1500000) && echo "OK" || echo "FAIL"
+rm ${OUT} ${DECODED}
+
+# appendable stream grown in parts (partial frames, then a full one)
+rm -f ${OUT}
+PART=$(mktemp)
+for RANGE in 1:1500000 1500001:597152 2097153:2500000 4597153:10000000; do
+    tail -c +${RANGE%:*} ${BIG} | head -c ${RANGE#*:} > ${PART}
+    ./main --pack --append -s ${PART} -d ${OUT} > /dev/null
 done
+./main --unpack -s ${OUT} -d ${DECODED} > /dev/null
+cmp -s ${DECODED} ${BIG} && echo "OK" || echo "FAIL"
+./main --unpack -s ${OUT} -d ${DECODED} --range 1000000:1500000 > /dev/null
+cmp -s ${DECODED} <(tail -c +1000001 ${BIG} | head -c 1500000) && echo "OK" || echo "FAIL"
+# failed append (unreadable source) leaves the stream as it was
+cp ${OUT} ${PART}
+! ./main --pack --append -s /tmp -d ${OUT} > /dev/null && cmp -s ${OUT} ${PART} && echo "OK" || echo "FAIL"
+rm ${OUT} ${DECODED} ${BIG} ${PART}
+
+# slow producer on a pipe, flushed after 50 ms and every 64 KiB
+(head -c 300000 ${FILE}; sleep 0.2; tail -c +300001 ${FILE}) | ./main --pack -s /dev/stdin -d ${OUT} --flush-ms 50 --flush-bytes 65536 > /dev/null
+./main --unpack -s ${OUT} -d ${DECODED} > /dev/null
+cmp -s ${DECODED} ${FILE} && echo "OK" || echo "FAIL"
+rm ${OUT} ${DECODED}
+
+# dictionary trained on all sample files
+DICT=$(mktemp)
+./main --train ${FILES} -d ${DICT} > /dev/null
+
+for FILE in ${FILES}; do
+    check ${FILE} --dict ${DICT}
+    check ${FILE} --dict ${DICT} --threads 4 --chunk-size 65536
+done
+
+./main --train ${FILES} --updater vitter -d ${DICT} > /dev/null
+check txt/1-passages-head_1K.tsv --dict ${DICT}
+rm ${DICT}
+
+# batch mode, the whole directory at once
+BATCH=$(mktemp -d)
+./main --pack --batch txt -d ${BATCH}/packed --threads 4 --chunk-size 65536 > /dev/null
+./main --unpack --batch ${BATCH}/packed -d ${BATCH}/decoded > /dev/null
+diff -r txt ${BATCH}/decoded > /dev/null && echo "OK" || echo "FAIL"
+
+./main --pack --batch txt -d ${BATCH}/all.hfa --archive --updater vitter > /dev/null
+./main --unpack --batch ${BATCH}/all.hfa --archive -d ${BATCH}/archive > /dev/null
+diff -r txt ${BATCH}/archive > /dev/null && echo "OK" || echo "FAIL"
+rm -r ${BATCH}
+
+# binary data (null bytes included)
+BINARY=$(mktemp)
+head -c 200000 /dev/urandom > ${BINARY}
+head -c 10000 /dev/zero >> ${BINARY}
+
+check ${BINARY}
+check ${BINARY} --threads 4 --chunk-size 65536
+check ${BINARY} --updater vitter
+check ${BINARY} --mode static
+check ${BINARY} --mode block --block-size 16384 --threads 2
+rm ${BINARY}
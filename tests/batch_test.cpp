@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <map>
+
+#include "../libs/batch.hpp"
+#include "../libs/huffman.hpp"
+
+namespace fs = std::filesystem;
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+static void write_file(const std::string& path, const std::string& data) {
+    fs::create_directories(fs::path(path).parent_path());
+    std::ofstream out(path, std::ios::binary);
+    out << data;
+}
+
+// fresh directory with files of very different sizes
+static std::map<std::string, std::string> make_tree(const std::string& dir) {
+    fs::remove_all(dir);
+
+    std::mt19937 gen(8);
+    std::geometric_distribution<int> dist(0.1);
+    std::map<std::string, std::string> files;
+    for (size_t size : { 0, 1, 100, 5000, 70000, 200000 }) {
+        std::string data(size, 0);
+        for (char& c : data) {
+            c = 'a' + dist(gen) % 40;
+        }
+
+        std::string name = (size % 2 ? "odd/" : "") + std::to_string(size) + ".txt";
+        files[name] = data;
+        write_file(dir + "/" + name, data);
+    }
+
+    return files;
+}
+
+static std::string temp_dir(const char* name) {
+    return testing::TempDir() + name;
+}
+
+TEST (BatchTest, SeparateFiles) {
+    std::string input = temp_dir("batch_in");
+    std::string packed = temp_dir("batch_packed");
+    std::string unpacked = temp_dir("batch_unpacked");
+    std::map<std::string, std::string> files = make_tree(input);
+    fs::remove_all(packed);
+    fs::remove_all(unpacked);
+
+    {
+        hf::Batch batch(3, 16384);
+        batch.set_verbose(false);
+        batch.set_updater(detail::VITTER);
+        batch.encode({ input }, packed, false);
+    }
+    {
+        hf::Batch batch(2, 1);
+        batch.set_verbose(false);
+        batch.decode({ packed }, unpacked, false);
+    }
+
+    for (const auto& file : files) {
+        ASSERT_EQ(read_file(unpacked + "/" + file.first), file.second);
+    }
+
+    // plain streams
+    std::istringstream src(read_file(packed + "/200000.txt.huf"));
+    std::ostringstream dest;
+    hf::Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.decode();
+    ASSERT_EQ(dest.str(), files["200000.txt"]);
+}
+
+TEST (BatchTest, Archive) {
+    std::string input = temp_dir("batch_in");
+    std::string archive = temp_dir("batch.hfa");
+    std::string unpacked = temp_dir("batch_unpacked");
+    std::map<std::string, std::string> files = make_tree(input);
+    fs::remove_all(unpacked);
+
+    {
+        hf::Batch batch(4, 10000);
+        batch.set_verbose(false);
+        batch.encode({ input }, archive, true);
+    }
+    {
+        hf::Batch batch(4, 10000);
+        batch.set_verbose(false);
+        batch.decode({ archive }, unpacked, true);
+    }
+
+    for (const auto& file : files) {
+        ASSERT_EQ(read_file(unpacked + "/" + file.first), file.second);
+    }
+
+    // names are relative
+    std::string bad = temp_dir("batch_bad.hfa");
+    write_file(bad, std::string("HUFA\x01\x05\x00../xx", 12) + std::string(8, '\0') + std::string(2, '\0'));
+    hf::Batch batch(2, 10000);
+    batch.set_verbose(false);
+    ASSERT_THROW(batch.decode({ bad }, unpacked, true), std::runtime_error);
+
+    // corrupt streams fail the batch
+    std::string corrupt = read_file(archive);
+    corrupt[corrupt.size() / 2] ^= 0x10;
+    write_file(bad, corrupt);
+    ASSERT_THROW(batch.decode({ bad }, unpacked, true), std::runtime_error);
+}
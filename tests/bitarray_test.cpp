@@ -404,3 +404,28 @@ TEST (BitArrayTest, TrimBit32) {
     ASSERT_EQ(ba.trim_bit(), 1);
     ASSERT_EQ(ba.get_bits_used(), 32 - 5 + 180 - 6);
 }
+
+TEST (BitArrayTest, PeekDropBits) {
+    BitArray<uint32_t> ba("1011 0010 1");
+    
+    ASSERT_EQ(ba.peek_bits(4), 0xB);
+    ASSERT_EQ(ba.peek_bits(9), 0x165);
+    ASSERT_EQ(ba.get_bits_used(), 9);
+    
+    ba.drop_bits(3);
+    ASSERT_EQ(ba.get_bits_used(), 6);
+    ASSERT_EQ(ba.peek_bits(6), 0x25);
+    ASSERT_EQ(ba.trim_bit(), 1);
+}
+
+TEST (BitArrayTest, PeekBitsCrossCell) {
+    BitArray<uint8_t> ba("1100 1010 0111");
+    
+    ASSERT_EQ(ba.peek_bits(8), 0xCA);
+    ba.drop_bits(2);
+    ASSERT_EQ(ba.peek_bits(8), 0x29);
+    ba.drop_bits(6);
+    ASSERT_EQ(ba.peek_bits(4), 0x7);
+    ASSERT_EQ(ba.trim_bit(), 0);
+    ASSERT_EQ(ba.get_bits_used(), 3);
+}
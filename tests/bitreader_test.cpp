@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+
+#include "../libs/bitreader.hpp"
+#include "../libs/bitwriter.hpp"
+
+using namespace bitarr;
+
+TEST (BitReaderTest, PeekConsume) {
+    std::string data("\xCA\xB8", 2);
+    BitReader reader(data.data(), data.size());
+
+    reader.refill();
+    ASSERT_EQ(reader.peek(4), 0xC);
+    reader.consume(4);
+    ASSERT_EQ(reader.peek(8), 0xAB);
+    reader.consume(9);
+    ASSERT_EQ(reader.get_bits_left(), 3);
+    ASSERT_FALSE(reader.overrun());
+}
+
+TEST (BitReaderTest, ZerosPastEnd) {
+    std::string data("\xFF", 1);
+    BitReader reader(data.data(), data.size());
+
+    reader.refill();
+    ASSERT_EQ(reader.peek(16), 0xFF00);
+    reader.consume(8);
+    ASSERT_FALSE(reader.overrun());
+    reader.consume(1);
+    ASSERT_TRUE(reader.overrun());
+}
+
+TEST (BitReaderTest, SameAsBitWriter) {
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> length(1, 57);
+
+    std::vector<std::pair<uint64_t, int>> codes;
+    std::ostringstream out;
+    BitWriter writer(out);
+
+    for (int i=0; i<10000; i++) {
+        int len = length(gen);
+        uint64_t code = gen() & ((1ULL << len) - 1);
+        codes.push_back({ code, len });
+        writer.put_bits(code, len);
+    }
+    writer.finish();
+
+    std::string data = out.str();
+    BitReader reader(data.data(), data.size());
+    for (auto [code, len] : codes) {
+        reader.refill();
+        ASSERT_EQ(reader.peek(len), code);
+        reader.consume(len);
+    }
+
+    ASSERT_LT(reader.get_bits_left(), 8);
+    ASSERT_FALSE(reader.overrun());
+}
+
+TEST (BitReaderTest, WordAndTail) {
+    std::mt19937 gen(2);
+    std::uniform_int_distribution<int> length(1, 57);
+
+    // every span size around the word refill boundary
+    for (size_t size=0; size<=24; size++) {
+        std::string data;
+        for (size_t i=0; i<size; i++) {
+            data += (char)gen();
+        }
+
+        BitReader reader(data.data(), data.size());
+        size_t pos = 0;
+        while (pos < size * 8) {
+            size_t len = length(gen);
+            reader.refill();
+
+            uint64_t expected = 0;
+            for (size_t i=pos; i<pos+len; i++) {
+                int bit = i < size * 8 ? (data[i / 8] >> (7 - i % 8)) & 1 : 0;
+                expected = (expected << 1) | bit;
+            }
+
+            ASSERT_EQ(reader.peek(len), expected);
+            reader.consume(len);
+            pos += len;
+
+            ASSERT_EQ(reader.overrun(), pos > size * 8);
+            if (!reader.overrun()) {
+                ASSERT_EQ(reader.get_bits_left(), size * 8 - pos);
+            }
+        }
+    }
+}
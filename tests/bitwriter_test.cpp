@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+
+#include "../libs/bitarray.hpp"
+#include "../libs/bitwriter.hpp"
+
+using namespace bitarr;
+
+TEST (BitWriterTest, Empty) {
+    std::ostringstream out;
+    BitWriter writer(out);
+    
+    writer.finish();
+    ASSERT_EQ(writer.get_bytes_written(), 0);
+    ASSERT_EQ(out.str(), "");
+}
+
+TEST (BitWriterTest, PadToByte) {
+    std::ostringstream out;
+    BitWriter writer(out);
+    
+    writer.put_bits(0x5, 3);
+    writer.put_bits(0x1, 1);
+    writer.put_bits(0x3, 2);
+    writer.finish();
+    
+    ASSERT_EQ(out.str(), std::string("\xBC", 1));
+}
+
+TEST (BitWriterTest, WholeWords) {
+    std::ostringstream out;
+    BitWriter writer(out);
+    
+    writer.put_bits(0xA, 4);
+    writer.put_bits(0x0123456789ABCDEF, 64);
+    writer.put_bits(0xF, 4);
+    ASSERT_EQ(writer.get_bytes_written(), 8);
+    
+    writer.finish();
+    ASSERT_EQ(writer.get_bytes_written(), 9);
+    ASSERT_EQ(out.str(), std::string("\xA0\x12\x34\x56\x78\x9A\xBC\xDE\xFF", 9));
+}
+
+TEST (BitWriterTest, BitArrayCodes) {
+    std::ostringstream out;
+    BitWriter writer(out);
+    
+    writer.put_bits(BitArray<uint8_t>("1100 1010 1"));
+    writer.put_bits(BitArray<uint64_t>("0111"));
+    writer.put_bits(BitArray<uint8_t>(""));
+    writer.finish();
+    
+    ASSERT_EQ(out.str(), std::string("\xCA\xB8", 2));
+}
+
+/*
+ * Same bitstream as appending to BitArray and trimming it
+ */
+TEST (BitWriterTest, SameAsBitArray) {
+    std::mt19937 rng(42);
+    
+    std::ostringstream out;
+    BitWriter writer(out);
+    BitArray<uint64_t> ba;
+    
+    for (int i=0; i<2000; i++) {
+        size_t len = rng() % 65;
+        uint64_t code = ((uint64_t)rng() << 32) | rng();
+        if (len < 64) {
+            code &= ((uint64_t)1 << len) - 1;
+        }
+        
+        writer.put_bits(code, len);
+        
+        for (int bit=len-1; bit>=0; bit--) {
+            ba <<= 1;
+            ba |= (code >> bit) & 1;
+        }
+    }
+    
+    writer.finish();
+    ba.pad_to_full_byte();
+    
+    std::string expected;
+    while (ba.can_trim_byte()) {
+        expected += (char)ba.trim_byte();
+    }
+    
+    ASSERT_EQ(out.str(), expected);
+}
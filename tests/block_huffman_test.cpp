@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+#include <stdexcept>
+
+#include "../libs/block_huffman.hpp"
+#include "../libs/static_huffman.hpp"
+
+using namespace detail;
+
+TEST (BlockTableTest, RoundTrip) {
+    CodeLengths lengths = { };
+    lengths['a'] = 1;
+    lengths['b'] = 2;
+    lengths['c'] = 3;
+    lengths[255] = 3;
+
+    std::ostringstream out;
+    bitarr::BitWriter writer(out);
+    write_table(writer, lengths);
+    writer.finish();
+    write_reuse(writer);
+    writer.finish();
+
+    std::string packed = out.str();
+    ASSERT_EQ(packed.size(), (table_bits(lengths) + 7) / 8 + 1);
+
+    CodeLengths read = { };
+    bitarr::BitReader reader(packed.data(), packed.size());
+    ASSERT_FALSE(read_table(reader, read));
+    ASSERT_TRUE(std::equal(lengths, lengths + N_SYMBOLS, read));
+    ASSERT_TRUE(read_table(reader, read));
+    ASSERT_EQ(reader.get_bits_left(), 0);
+
+    // run of zeros past the last symbol
+    std::string bad = "\x00\x0F\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF";
+    bitarr::BitReader bad_reader(bad.data(), bad.size());
+    ASSERT_THROW(read_table(bad_reader, read), std::runtime_error);
+}
+
+static std::string pack_block(const std::string& data, uint32_t block_size, unsigned int threads) {
+    std::istringstream src(data);
+    std::ostringstream dest;
+    hf::BlockHuffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_block_size(block_size);
+    coder.set_threads(threads);
+    coder.encode();
+
+    return dest.str();
+}
+
+static std::string unpack_block(const std::string& packed, unsigned int threads) {
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::BlockHuffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_threads(threads);
+    coder.decode();
+
+    return dest.str();
+}
+
+TEST (BlockHuffmanTest, RoundTrip) {
+    std::mt19937 gen(4);
+    std::geometric_distribution<int> dist(0.05);
+
+    // statistics change halfway
+    std::string data;
+    for (int i=0; i<60000; i++) {
+        data += (char)(dist(gen) % 256 + (i < 30000 ? 0 : 'a'));
+    }
+
+    for (uint32_t block_size : { 1000u, 16384u, 1u << 20 }) {
+        for (unsigned int threads : { 1u, 3u }) {
+            ASSERT_EQ(unpack_block(pack_block(data, block_size, threads), 4 - threads), data);
+        }
+    }
+
+    ASSERT_EQ(unpack_block(pack_block("", 1000, 2), 2), "");
+    ASSERT_EQ(unpack_block(pack_block(std::string(5000, 'x'), 1000, 2), 2), std::string(5000, 'x'));
+}
+
+TEST (BlockHuffmanTest, ReuseTable) {
+    std::string data;
+    for (int i=0; i<40000; i++) {
+        data += "abcdefgh"[i * 7 % 8];
+    }
+
+    // blocks with the same statistics don't repeat the table
+    std::string shared = pack_block(data, 4000, 2);
+    ASSERT_EQ(unpack_block(shared, 2), data);
+
+    // 8 equally likely bytes take 3 bits each, reuse mark takes 1 byte
+    std::string single = pack_block(data.substr(0, 4000), 4000, 1);
+    ASSERT_EQ(shared.size(), single.size() + 9 * (hf::container::FRAME_OVERHEAD + 1 + 4000 * 3 / 8));
+}
+
+TEST (BlockHuffmanTest, Corrupt) {
+    std::string data(20000, 'a');
+    for (size_t i=0; i<data.size(); i+=7) {
+        data[i] = 'b' + i % 13;
+    }
+
+    std::string packed = pack_block(data, 4096, 2);
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<size_t> pos(hf::container::HEADER_SIZE, packed.size() - 1);
+    for (int i=0; i<50; i++) {
+        std::string corrupt = packed;
+        corrupt[pos(gen)] ^= 1 << (i % 8);
+        ASSERT_THROW(unpack_block(corrupt, 2), std::runtime_error);
+    }
+
+    // static decoder refuses it
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::StaticHuffman coder(src, dest);
+    coder.set_verbose(false);
+    ASSERT_THROW(coder.decode(), std::runtime_error);
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+#include <stdexcept>
+
+#include "../libs/canonical.hpp"
+#include "../libs/static_huffman.hpp"
+#include "../libs/huffman.hpp"
+#include "../libs/bitwriter.hpp"
+
+using namespace detail;
+
+TEST (CanonicalTest, Lengths) {
+    Histogram histogram = { };
+    histogram['a'] = 45;
+    histogram['b'] = 13;
+    histogram['c'] = 12;
+    histogram['d'] = 16;
+    histogram['e'] = 9;
+    histogram['f'] = 5;
+
+    CodeLengths lengths;
+    build_lengths(histogram, MAX_CANONICAL_BITS, lengths);
+
+    // textbook example (CLRS)
+    ASSERT_EQ(lengths['a'], 1);
+    ASSERT_EQ(lengths['b'], 3);
+    ASSERT_EQ(lengths['c'], 3);
+    ASSERT_EQ(lengths['d'], 3);
+    ASSERT_EQ(lengths['e'], 4);
+    ASSERT_EQ(lengths['f'], 4);
+    ASSERT_EQ(lengths['g'], 0);
+    ASSERT_EQ(coded_bits(histogram, lengths), 224);
+}
+
+TEST (CanonicalTest, SingleSymbol) {
+    Histogram histogram = { };
+    histogram[0] = 1000;
+
+    CodeLengths lengths;
+    build_lengths(histogram, MAX_CANONICAL_BITS, lengths);
+    ASSERT_EQ(lengths[0], 1);
+    ASSERT_TRUE(check_lengths(lengths));
+}
+
+TEST (CanonicalTest, LengthLimit) {
+    // Fibonacci counts give the deepest tree
+    Histogram histogram = { };
+    uint64_t a = 1, b = 1;
+    for (int symbol=0; symbol<40; symbol++) {
+        histogram[symbol] = a;
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+
+    CodeLengths lengths;
+    build_lengths(histogram, MAX_CANONICAL_BITS, lengths);
+    ASSERT_TRUE(check_lengths(lengths));
+
+    // complete code
+    uint32_t kraft = 0;
+    for (int symbol=0; symbol<N_SYMBOLS; symbol++) {
+        ASSERT_LE(lengths[symbol], MAX_CANONICAL_BITS);
+        if (lengths[symbol]) {
+            kraft += 1 << (MAX_CANONICAL_BITS - lengths[symbol]);
+        }
+    }
+    ASSERT_EQ(kraft, 1 << MAX_CANONICAL_BITS);
+}
+
+TEST (CanonicalTest, InvalidLengths) {
+    CodeLengths lengths = { };
+    lengths[0] = 1;
+    lengths[1] = 1;
+    lengths[2] = 1;
+    ASSERT_FALSE(check_lengths(lengths));
+
+    CanonicalDecoder decoder;
+    ASSERT_THROW(decoder.build(lengths), std::runtime_error);
+}
+
+TEST (CanonicalTest, EncodeDecode) {
+    std::mt19937 gen(1);
+    std::geometric_distribution<int> dist(0.01);
+
+    std::string data;
+    Histogram histogram = { };
+    for (int i=0; i<100000; i++) {
+        data += (char)(dist(gen) % 256);
+    }
+    count_bytes(data.data(), data.size(), histogram);
+
+    CodeLengths lengths;
+    build_lengths(histogram, MAX_CANONICAL_BITS, lengths);
+
+    CanonicalEncoder encoder;
+    encoder.build(lengths);
+    CanonicalDecoder decoder;
+    decoder.build(lengths);
+
+    std::ostringstream out;
+    bitarr::BitWriter writer(out);
+    for (char c : data) {
+        writer.put_bits(encoder.bits[(uint8_t)c], encoder.length[(uint8_t)c]);
+    }
+    writer.finish();
+
+    std::string packed = out.str();
+    ASSERT_EQ(packed.size(), (coded_bits(histogram, lengths) + 7) / 8);
+
+    bitarr::BitReader reader(packed.data(), packed.size());
+    for (char c : data) {
+        ASSERT_EQ(decoder.decode(reader), (uint8_t)c);
+    }
+}
+
+static std::string pack_static(const std::string& data, uint32_t frame_size) {
+    std::istringstream src(data);
+    std::ostringstream dest;
+    hf::StaticHuffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_frame_size(frame_size);
+    coder.encode();
+
+    return dest.str();
+}
+
+static std::string unpack_static(const std::string& packed) {
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::StaticHuffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.decode();
+
+    return dest.str();
+}
+
+TEST (StaticHuffmanTest, RoundTrip) {
+    std::mt19937 gen(2);
+    std::geometric_distribution<int> dist(0.05);
+
+    std::string data;
+    for (int i=0; i<50000; i++) {
+        data += (char)(dist(gen) % 256);
+    }
+
+    for (uint32_t frame_size : { 1000u, 50000u, 1u << 20 }) {
+        ASSERT_EQ(unpack_static(pack_static(data, frame_size)), data);
+    }
+
+    ASSERT_EQ(unpack_static(pack_static("", 1000)), "");
+    ASSERT_EQ(unpack_static(pack_static(std::string(5000, 'x'), 1000)), std::string(5000, 'x'));
+}
+
+TEST (StaticHuffmanTest, Corrupt) {
+    std::string data(20000, 'a');
+    for (size_t i=0; i<data.size(); i+=7) {
+        data[i] = 'b' + i % 13;
+    }
+
+    std::string packed = pack_static(data, 4096);
+
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<size_t> pos(hf::container::HEADER_SIZE, packed.size() - 1);
+    for (int i=0; i<50; i++) {
+        std::string corrupt = packed;
+        corrupt[pos(gen)] ^= 1 << (i % 8);
+        ASSERT_THROW(unpack_static(corrupt), std::runtime_error);
+    }
+
+    // adaptive decoder refuses it
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::Huffman coder(src, dest);
+    coder.set_verbose(false);
+    ASSERT_THROW(coder.decode(), std::runtime_error);
+}
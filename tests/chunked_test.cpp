@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+#include <stdexcept>
+
+#include "../libs/chunked.hpp"
+#include "../libs/huffman.hpp"
+
+using namespace hf;
+
+static std::string random_binary(size_t length, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::geometric_distribution<int> dist(0.02);
+
+    std::string data;
+    for (size_t i=0; i<length; i++) {
+        data += (char)(dist(gen) % 256);
+    }
+
+    return data;
+}
+
+static std::string pack(const std::string& data, unsigned int threads, size_t chunk_size) {
+    std::string packed;
+    io::MemorySource src(data.data(), data.size());
+    io::StringSink dest(packed);
+    ChunkedHuffman coder(src, dest, threads, chunk_size);
+    coder.encode();
+
+    return packed;
+}
+
+static std::string unpack(const std::string& packed, unsigned int threads, uint64_t segment_bytes = 64 << 20) {
+    std::string raw;
+    io::MemorySource src(packed.data(), packed.size());
+    io::StringSink dest(raw);
+    ChunkedHuffman coder(src, dest, threads, 1);
+    coder.set_segment_bytes(segment_bytes);
+    coder.decode();
+
+    return raw;
+}
+
+TEST (ChunkedTest, RoundTrip) {
+    std::string data = random_binary(50000, 1);
+
+    for (size_t chunk_size : { 1000, 4096, 65536, 1 << 20 }) {
+        for (unsigned int threads : { 1, 2, 3, 8 }) {
+            std::string packed = pack(data, threads, chunk_size);
+            ASSERT_EQ(unpack(packed, threads), data);
+
+            // frames are independent, the sequential decoder reads them too
+            std::istringstream src(packed);
+            std::ostringstream dest;
+            Huffman coder(src, dest);
+            coder.set_verbose(false);
+            coder.decode();
+            ASSERT_EQ(dest.str(), data);
+        }
+    }
+
+    ASSERT_EQ(unpack(pack("", 4, 4096), 4), "");
+}
+
+TEST (ChunkedTest, SameOutputForAnyThreads) {
+    std::string data = random_binary(100000, 2);
+
+    std::string serial = pack(data, 1, 4096);
+    for (unsigned int threads : { 2, 4, 7 }) {
+        ASSERT_EQ(pack(data, threads, 4096), serial);
+    }
+}
+
+TEST (ChunkedTest, Corrupt) {
+    std::string data = random_binary(50000, 3);
+    std::string packed = pack(data, 4, 4096);
+
+    // last frame cut short
+    std::string truncated = packed.substr(0, packed.size() - 100);
+    ASSERT_THROW(unpack(truncated, 4), std::runtime_error);
+
+    // payload of the second frame (raw size u32, packed size u32, payload)
+    std::string corrupt = packed;
+    const unsigned char* sizes = (const unsigned char*)&packed[container::HEADER_SIZE];
+    uint32_t first_packed = sizes[4] | sizes[5] << 8 | sizes[6] << 16 | (uint32_t)sizes[7] << 24;
+    size_t second = container::HEADER_SIZE + container::FRAME_OVERHEAD + first_packed;
+    corrupt[second + 8 + 10] ^= 0x55;
+    ASSERT_THROW(unpack(corrupt, 4), std::runtime_error);
+
+    // frames depend on each other
+    std::istringstream src(data);
+    std::ostringstream dest;
+    Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_frame_size(4096);
+    coder.encode();
+    ASSERT_THROW(unpack(dest.str(), 4), std::runtime_error);
+}
+
+TEST (ChunkedTest, LongSegments) {
+    std::string data = random_binary(200000, 4);
+
+    // checkpoint only at the start, then every 10 frames
+    for (size_t checkpoints : { 1000, 10 }) {
+        std::string packed;
+        io::MemorySource src(data.data(), data.size());
+        io::StringSink dest(packed);
+        Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.set_frame_size(4096);
+        coder.set_checkpoints(checkpoints);
+        coder.encode();
+
+        // segments are cut and continued with the same model
+        for (uint64_t segment_bytes : { 1, 3 * 4096, 64 << 20 }) {
+            ASSERT_EQ(unpack(packed, 3, segment_bytes), data);
+            ASSERT_EQ(unpack(packed, 1, segment_bytes), data);
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+#include <stdexcept>
+
+#include "../libs/container.hpp"
+#include "../libs/huffman.hpp"
+
+using namespace hf;
+
+// stream that can't seek, its length is unknown to the encoder
+struct NoSeekBuf : std::streambuf {
+    NoSeekBuf(std::string& data) { setg(&data[0], &data[0], &data[0] + data.size()); }
+};
+
+static std::string random_binary(size_t length, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::geometric_distribution<int> dist(0.02);
+
+    std::string data;
+    for (size_t i=0; i<length; i++) {
+        data += (char)(dist(gen) % 256);
+    }
+
+    return data;
+}
+
+static std::string pack(std::istream& src, uint32_t frame_size, bool independent, bool pipeline = false) {
+    std::ostringstream dest;
+    Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_frame_size(frame_size);
+    coder.set_independent(independent);
+    coder.set_pipeline(pipeline);
+    coder.encode();
+
+    return dest.str();
+}
+
+static std::string pack(const std::string& data, uint32_t frame_size = container::DEFAULT_FRAME_SIZE,
+                        bool independent = false, bool pipeline = false) {
+    std::istringstream src(data);
+    return pack(src, frame_size, independent, pipeline);
+}
+
+static std::string unpack(const std::string& packed, bool pipeline = false) {
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_pipeline(pipeline);
+    coder.decode();
+
+    return dest.str();
+}
+
+TEST (ContainerTest, Adler32) {
+    std::string text = "Wikipedia";
+    ASSERT_EQ(container::adler32(text.data(), text.size()), 0x11E60398);
+    ASSERT_EQ(container::adler32(nullptr, 0), 1);
+
+    // running checksum is the same as one-shot
+    std::string data = random_binary(20000, 1);
+    uint32_t first = container::adler32(data.data(), 7000);
+    ASSERT_EQ(container::adler32(data.data() + 7000, 13000, first), container::adler32(data.data(), data.size()));
+}
+
+TEST (ContainerTest, Empty) {
+    std::string packed = pack("");
+    ASSERT_EQ(packed.size(), container::HEADER_SIZE);
+    ASSERT_EQ(unpack(packed), "");
+}
+
+TEST (ContainerTest, BinaryRoundTrip) {
+    std::string data = random_binary(50000, 2);
+    data += std::string(1000, '\0');
+
+    ASSERT_EQ(unpack(pack(data)), data);
+    ASSERT_EQ(unpack(pack(data, 4096)), data);
+    ASSERT_EQ(unpack(pack(data, 4096, true)), data);
+    // last frame full
+    ASSERT_EQ(unpack(pack(data, data.size() / 3)), data);
+}
+
+TEST (ContainerTest, Pipeline) {
+    std::string data = random_binary(50000, 7);
+
+    // same stream as sequential coding
+    std::string packed = pack(data, 4096, false, true);
+    ASSERT_EQ(packed, pack(data, 4096));
+    ASSERT_EQ(unpack(packed, true), data);
+    ASSERT_EQ(unpack(pack(data, 4096, true, true), true), data);
+
+    std::string corrupt = packed;
+    corrupt[corrupt.size() / 2] ^= 0x10;
+    ASSERT_THROW(unpack(corrupt, true), std::runtime_error);
+    ASSERT_THROW(unpack(packed.substr(0, packed.size() - 1), true), std::runtime_error);
+}
+
+TEST (ContainerTest, UnknownLength) {
+    std::string data = random_binary(30000, 3);
+    std::string copy = data;
+
+    NoSeekBuf buf(copy);
+    std::istream src(&buf);
+    std::string packed = pack(src, 4096, false);
+
+    ASSERT_EQ(unpack(packed), data);
+    ASSERT_EQ(packed, pack(data, 4096).replace(12, 8, std::string(8, '\xFF')) +
+                      std::string("\0\0\0\0\0\0\0\0\x01\0\0\0", 12));
+}
+
+TEST (ContainerTest, NotAHuffmanStream) {
+    ASSERT_THROW(unpack("PK\x03\x04 definitely not huffman"), std::runtime_error);
+
+    std::string packed = pack("abc");
+    packed[4] = container::VERSION + 1;
+    ASSERT_THROW(unpack(packed), std::runtime_error);
+}
+
+TEST (ContainerTest, Truncated) {
+    std::string packed = pack(random_binary(10000, 4), 4096);
+
+    for (size_t size : { (size_t)10, container::HEADER_SIZE, container::HEADER_SIZE + 5,
+                         packed.size() / 2, packed.size() - 1 }) {
+        ASSERT_THROW(unpack(packed.substr(0, size)), std::runtime_error) << size;
+    }
+}
+
+TEST (ContainerTest, Corrupt) {
+    std::string packed = pack(random_binary(10000, 5), 4096);
+
+    std::mt19937 gen(6);
+    std::uniform_int_distribution<size_t> pos(container::HEADER_SIZE, packed.size() - 1);
+
+    for (int i=0; i<50; i++) {
+        std::string corrupt = packed;
+        corrupt[pos(gen)] ^= 1 << (i % 8);
+        ASSERT_THROW(unpack(corrupt), std::runtime_error);
+    }
+}
+
+TEST (ContainerTest, FlushPoints) {
+    std::string data = random_binary(20000, 9);
+
+    std::string packed;
+    io::MemorySource no_source(nullptr, 0);
+    io::StringSink sink(packed);
+    Huffman coder(no_source, sink);
+    coder.set_verbose(false);
+    coder.set_frame_size(4096);
+
+    // data written before a flush decode from the output so far
+    size_t pieces[] = { 100, 5000, 1, 9000, 0, 5899 };
+    size_t written = 0;
+    for (size_t piece : pieces) {
+        coder.write(data.data() + written, piece);
+        written += piece;
+        coder.flush();
+
+        io::MemorySource src(packed.data(), packed.size());
+        container::Header header = container::read_header(src);
+        ASSERT_EQ(header.length, container::UNKNOWN_LENGTH);
+
+        std::string nowhere;
+        io::StringSink nowhere_sink(nowhere);
+        Huffman decoder(no_source, nowhere_sink);
+        decoder.reset_model();
+
+        std::string raw;
+        container::Frame frame;
+        while (src.remaining() > 0) {
+            container::read_frame(src, header, frame);
+            size_t start = raw.size();
+            raw.resize(start + frame.raw_size);
+            decoder.decode_frame(frame.packed, frame.packed_size, &raw[start], frame.raw_size);
+        }
+        ASSERT_EQ(raw, data.substr(0, written));
+    }
+
+    coder.finish();
+    ASSERT_EQ(unpack(packed), data);
+    ASSERT_EQ(unpack(packed, true), data);
+
+    // flush points need frames of any size, the error names the option
+    for (std::string option : { "--seekable", "--checkpoints", "--append" }) {
+        Huffman indexed(no_source, sink);
+        indexed.set_seekable(option == "--seekable");
+        indexed.set_checkpoints(option == "--checkpoints" ? 4 : 0);
+        indexed.set_appendable(option == "--append");
+        try {
+            indexed.write(data.data(), 10);
+            FAIL() << option;
+        }
+        catch (const std::invalid_argument& e) {
+            ASSERT_NE(std::string(e.what()).find(option), std::string::npos) << e.what();
+        }
+    }
+}
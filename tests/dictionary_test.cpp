@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../libs/dictionary.hpp"
+#include "../libs/huffman.hpp"
+#include "../libs/huffman_context.hpp"
+
+using namespace detail;
+
+// short messages of a skewed alphabet
+static std::vector<std::string> messages(size_t n, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::geometric_distribution<int> dist(0.15);
+    std::uniform_int_distribution<int> length(20, 200);
+
+    std::vector<std::string> result(n);
+    for (std::string& message : result) {
+        message.resize(length(gen));
+        for (char& c : message) {
+            c = ' ' + dist(gen) % 90;
+        }
+    }
+
+    return result;
+}
+
+static hf::Dictionary train(const std::vector<std::string>& samples, Updater updater) {
+    Histogram histogram = { };
+    for (const std::string& sample : samples) {
+        count_bytes(sample.data(), sample.size(), histogram);
+    }
+
+    return hf::Dictionary(histogram, updater);
+}
+
+static std::string save(const hf::Dictionary& dictionary) {
+    std::string file;
+    hf::io::StringSink sink(file);
+    dictionary.save(sink);
+
+    return file;
+}
+
+static hf::Dictionary load(const std::string& file) {
+    hf::io::MemorySource source(file.data(), file.size());
+    return hf::Dictionary(source);
+}
+
+TEST (DictionaryTest, SaveLoad) {
+    for (Updater updater : { FGK, VITTER }) {
+        hf::Dictionary dictionary = train(messages(100, 1), updater);
+        dictionary.get_tree().validate();
+
+        std::string file = save(dictionary);
+        hf::Dictionary loaded = load(file);
+        ASSERT_EQ(loaded.get_id(), dictionary.get_id());
+        ASSERT_EQ(loaded.get_updater(), updater);
+        ASSERT_EQ(save(loaded), file);
+    }
+
+    // other samples give other id
+    ASSERT_NE(train(messages(100, 2), FGK).get_id(), train(messages(100, 1), FGK).get_id());
+}
+
+TEST (DictionaryTest, SmallMessages) {
+    hf::Dictionary dictionary = train(messages(1000, 1), VITTER);
+    std::vector<std::string> test = messages(1000, 2);
+
+    hf::HuffmanContext plain(VITTER);
+    hf::HuffmanContext pretrained(VITTER);
+    pretrained.set_dictionary(&dictionary);
+
+    hf::HuffmanContext decoder;
+    decoder.set_dictionary(&dictionary);
+
+    size_t plain_size = 0;
+    size_t pretrained_size = 0;
+    std::string packed;
+    std::string raw;
+    for (const std::string& message : test) {
+        plain.reset();
+        plain_size += plain.encode(message.data(), message.size(), packed).packed_bytes;
+
+        // every message starts from the dictionary
+        pretrained.reset();
+        pretrained_size += pretrained.encode(message.data(), message.size(), packed).packed_bytes;
+
+        decoder.reset();
+        decoder.decode(packed.data(), packed.size(), raw);
+        ASSERT_EQ(raw, message);
+    }
+
+    // no literals for every new byte
+    ASSERT_LT(pretrained_size * 5, plain_size * 4);
+}
+
+static std::string pack(const std::string& data, const hf::Dictionary* dictionary, bool independent) {
+    std::istringstream src(data);
+    std::ostringstream dest;
+    hf::Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_dictionary(dictionary);
+    coder.set_independent(independent);
+    coder.set_frame_size(1000);
+    coder.encode();
+
+    return dest.str();
+}
+
+static std::string unpack(const std::string& packed, const hf::Dictionary* dictionary) {
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.set_dictionary(dictionary);
+    coder.decode();
+
+    return dest.str();
+}
+
+TEST (DictionaryTest, Stream) {
+    hf::Dictionary fgk = train(messages(100, 1), FGK);
+    hf::Dictionary vitter = train(messages(100, 1), VITTER);
+    hf::Dictionary other = train(messages(100, 2), FGK);
+
+    std::string data;
+    for (const std::string& message : messages(50, 3)) {
+        data += message;
+    }
+    // bytes the dictionary hasn't seen
+    data += "\x01\x02\xFF";
+
+    for (bool independent : { false, true }) {
+        ASSERT_EQ(unpack(pack(data, &fgk, independent), &fgk), data);
+        ASSERT_EQ(unpack(pack(data, &vitter, independent), &vitter), data);
+    }
+
+    std::string packed = pack(data, &fgk, false);
+    ASSERT_THROW(unpack(packed, nullptr), std::runtime_error);
+    ASSERT_THROW(unpack(packed, &other), std::runtime_error);
+    ASSERT_THROW(unpack(packed, &vitter), std::runtime_error);
+
+    // ignored when the stream doesn't use it
+    ASSERT_EQ(unpack(pack(data, nullptr, false), &fgk), data);
+}
+
+TEST (DictionaryTest, Corrupt) {
+    std::string file = save(train(messages(100, 1), VITTER));
+
+    ASSERT_THROW(load(""), std::runtime_error);
+    ASSERT_THROW(load(file.substr(0, file.size() - 1)), std::runtime_error);
+    ASSERT_THROW(load(file + "x"), std::runtime_error);
+
+    std::mt19937 gen(6);
+    std::uniform_int_distribution<size_t> pos(0, file.size() - 1);
+    for (int i=0; i<50; i++) {
+        std::string corrupt = file;
+        corrupt[pos(gen)] ^= 1 << (i % 8);
+        ASSERT_THROW(load(corrupt), std::runtime_error);
+    }
+}
+
+TEST (DictionaryTest, CorruptState) {
+    HuffTree trained(VITTER);
+    for (int i=0; i<3000; i++) {
+        trained.update(i * i % 71);
+    }
+
+    std::string state;
+    trained.save(state);
+
+    // checksum aside, loading never leaves an inconsistent tree
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<size_t> pos(0, state.size() - 1);
+    HuffTree tree;
+    for (int i=0; i<500; i++) {
+        std::string corrupt = state;
+        corrupt[pos(gen)] ^= 1 << (i % 8);
+
+        try {
+            tree.load(corrupt.data(), corrupt.size());
+        }
+        catch (const std::runtime_error&) {
+            continue;
+        }
+
+        ASSERT_NO_THROW(tree.validate());
+    }
+
+    tree.load(state.data(), state.size());
+    for (int i=0; i<100; i++) {
+        tree.update(i % 13);
+        trained.update(i % 13);
+    }
+    for (int s=0; s<256; s++) {
+        if (trained.get_leaf(s) != NO_NODE) {
+            ASSERT_EQ(tree.get_code(tree.get_leaf(s)).bits, trained.get_code(trained.get_leaf(s)).bits);
+        }
+    }
+}
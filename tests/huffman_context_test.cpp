@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../libs/huffman_context.hpp"
+
+// allocations of every thread are counted on that thread
+// (the binary runs multithreaded tests too, a shared counter would race)
+static thread_local size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static std::vector<std::string> records(size_t n, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::geometric_distribution<int> dist(0.1);
+    std::uniform_int_distribution<int> length(0, 300);
+
+    std::vector<std::string> result(n);
+    for (std::string& record : result) {
+        record.resize(length(gen));
+        for (char& c : record) {
+            c = 'a' + dist(gen) % 26;
+        }
+    }
+
+    return result;
+}
+
+TEST (HuffmanContextTest, RoundTrip) {
+    hf::HuffmanContext encoder, decoder(detail::FGK);
+    std::string packed, raw;
+
+    // model carries over between records
+    for (const std::string& record : records(200, 1)) {
+        hf::CodingStats stats = encoder.encode(record.data(), record.size(), packed);
+        ASSERT_EQ(stats.raw_bytes, record.size());
+        ASSERT_EQ(stats.packed_bytes, packed.size());
+        ASSERT_EQ(decoder.decoded_size(packed.data(), packed.size()), record.size());
+
+        decoder.decode(packed.data(), packed.size(), raw);
+        ASSERT_EQ(raw, record);
+    }
+
+    // independent records
+    for (const std::string& record : records(200, 2)) {
+        encoder.reset();
+        encoder.encode(record.data(), record.size(), packed);
+
+        decoder.reset();
+        decoder.decode(packed.data(), packed.size(), raw);
+        ASSERT_EQ(raw, record);
+    }
+}
+
+TEST (HuffmanContextTest, Spans) {
+    hf::HuffmanContext encoder(detail::VITTER), decoder(detail::VITTER);
+    std::string record = "abracadabra, abracadabra";
+
+    char packed[64];
+    hf::CodingStats stats = encoder.encode(record.data(), record.size(), packed, sizeof(packed));
+
+    char raw[64];
+    ASSERT_THROW(decoder.decode(packed, stats.packed_bytes, raw, 10), std::length_error);
+    decoder.reset();
+    ASSERT_EQ(decoder.decode(packed, stats.packed_bytes, raw, sizeof(raw)).raw_bytes, record.size());
+    ASSERT_EQ(std::string(raw, record.size()), record);
+
+    encoder.reset();
+    ASSERT_THROW(encoder.encode(record.data(), record.size(), packed, 4), std::length_error);
+
+    // size claims more bytes than the bits there are
+    std::string bogus = "\xFF\x01\x00";
+    ASSERT_THROW(decoder.decode(bogus.data(), bogus.size(), raw, sizeof(raw)), std::runtime_error);
+}
+
+TEST (HuffmanContextTest, NoAllocationsWhenWarm) {
+    hf::HuffmanContext encoder, decoder;
+    std::vector<std::string> data = records(100, 3);
+    std::string packed, raw;
+
+    auto round = [&]() {
+        for (const std::string& record : data) {
+            encoder.reset();
+            encoder.encode(record.data(), record.size(), packed);
+            decoder.reset();
+            decoder.decode(packed.data(), packed.size(), raw);
+        }
+    };
+
+    size_t cold = allocations;
+    round();
+    ASSERT_GT(allocations, cold);
+
+    size_t before = allocations;
+    round();
+    ASSERT_EQ(allocations, before);
+    ASSERT_EQ(raw, data.back());
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+
+#include "../libs/hufftree.hpp"
+#include "../libs/huffman.hpp"
+
+using namespace detail;
+
+// skewed byte source over all 256 values
+static std::string random_text(size_t length, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::geometric_distribution<int> dist(0.05);
+
+    std::string text;
+    for (size_t i=0; i<length; i++) {
+        text += (char)(dist(gen) % 256);
+    }
+
+    return text;
+}
+
+static void feed_and_validate(Updater updater) {
+    HuffTree tree(updater);
+    tree.validate();
+
+    std::string text = random_text(20000, 1);
+    for (char c : text) {
+        tree.update(c);
+        tree.validate();
+    }
+
+    ASSERT_EQ(tree[HuffTree::ROOT].count, text.size());
+}
+
+TEST (HuffTreeTest, FGKValid) {
+    feed_and_validate(FGK);
+}
+
+TEST (HuffTreeTest, VitterValid) {
+    feed_and_validate(VITTER);
+}
+
+TEST (HuffTreeTest, VitterSameCounts) {
+    HuffTree fgk(FGK), vitter(VITTER);
+
+    std::string text = random_text(5000, 2);
+    for (char c : text) {
+        fgk.update(c);
+        vitter.update(c);
+    }
+
+    for (int symbol=0; symbol<256; symbol++) {
+        NodeIndex a = fgk.get_leaf(symbol);
+        NodeIndex b = vitter.get_leaf(symbol);
+
+        ASSERT_EQ(a == NO_NODE, b == NO_NODE);
+        if (a != NO_NODE) {
+            ASSERT_EQ(fgk[a].count, vitter[b].count);
+        }
+    }
+}
+
+TEST (HuffTreeTest, VitterRoundTrip) {
+    std::string text = random_text(50000, 3);
+
+    std::istringstream src(text);
+    std::ostringstream packed;
+    hf::Huffman encoder(src, packed, VITTER);
+    encoder.set_verbose(false);
+    encoder.encode();
+
+    std::istringstream packed_src(packed.str());
+    std::ostringstream decoded;
+    hf::Huffman decoder(packed_src, decoded, VITTER);
+    decoder.set_verbose(false);
+    decoder.decode();
+
+    ASSERT_EQ(decoded.str(), text);
+}
+
+TEST (HuffTreeTest, Reset) {
+    HuffTree tree(FGK);
+    for (char c : random_text(3000, 4)) {
+        tree.update(c);
+        tree.get_code(tree.get_leaf(c));
+    }
+
+    // same codes as a fresh tree after the same updates
+    tree.reset(VITTER);
+    tree.validate();
+    HuffTree fresh(VITTER);
+
+    for (char c : random_text(3000, 5)) {
+        tree.update(c);
+        fresh.update(c);
+
+        const Code& a = tree.get_code(tree.get_leaf(c));
+        const Code& b = fresh.get_code(fresh.get_leaf(c));
+        ASSERT_EQ(a.bits, b.bits);
+        ASSERT_EQ(a.length, b.length);
+    }
+
+    tree.validate();
+}
+
+// Fibonacci frequencies give the deepest Huffman trees
+static size_t fibonacci_depth(int count_limit, int symbols = 26) {
+    HuffTree tree(FGK);
+    tree.set_count_limit(count_limit);
+
+    int a = 1, b = 1;
+    for (int s=1; s<=symbols; s++) {
+        for (int i=0; i<a; i++) {
+            tree.update(s);
+        }
+
+        int next = a + b;
+        a = b;
+        b = next;
+    }
+
+    tree.validate();
+
+    size_t depth = tree.get_code(tree.get_nyt()).length;
+    for (int s=1; s<=symbols; s++) {
+        depth = std::max<size_t>(depth, tree.get_code(tree.get_leaf(s)).length);
+    }
+
+    return depth;
+}
+
+TEST (HuffTreeTest, Aging) {
+    ASSERT_THROW(HuffTree(FGK).set_count_limit(MIN_COUNT_LIMIT - 1), std::invalid_argument);
+    ASSERT_THROW(HuffTree(FGK).set_count_limit(MAX_COUNT_LIMIT + 1), std::invalid_argument);
+
+    for (Updater updater : { FGK, VITTER }) {
+        HuffTree tree(updater);
+        tree.set_count_limit(MIN_COUNT_LIMIT);
+
+        for (char c : random_text(20000, 6)) {
+            tree.update(c);
+            ASSERT_LT(tree[HuffTree::ROOT].count, MIN_COUNT_LIMIT);
+        }
+        tree.validate();
+
+        // limit survives reset
+        tree.reset(updater);
+        ASSERT_EQ(tree.get_count_limit(), MIN_COUNT_LIMIT);
+    }
+
+    // total below F(17) keeps codes within 17 bits
+    ASSERT_GT(fibonacci_depth(0), 17u);
+    ASSERT_LE(fibonacci_depth(1 << 10), 17u);
+    // total of 32 symbols crosses MAX_COUNT_LIMIT a few times
+    ASSERT_LE(fibonacci_depth(MAX_COUNT_LIMIT, 32), AGED_MAX_CODE_BITS);
+
+    // both sides rescale at the same symbols
+    std::string text = random_text(50000, 7) + std::string(20000, 'a') + random_text(50000, 8);
+    std::istringstream src(text);
+    std::ostringstream packed;
+    hf::Huffman encoder(src, packed, VITTER);
+    encoder.set_verbose(false);
+    encoder.set_aging(true);
+    encoder.encode();
+
+    std::istringstream packed_src(packed.str());
+    std::ostringstream decoded;
+    hf::Huffman decoder(packed_src, decoded, FGK);
+    decoder.set_verbose(false);
+    decoder.decode();
+
+    ASSERT_TRUE(decoder.get_aging());
+    ASSERT_EQ(decoded.str(), text);
+}
+
+TEST (HuffTreeTest, CountCeiling) {
+    // without aging counts are halved before weights overflow
+    for (Updater updater : { FGK, VITTER }) {
+        HuffTree tree(updater);
+        int32_t counts[256] = { };
+        counts['a'] = COUNT_CEILING - 3;
+        counts['b'] = 1;
+        tree.set_counts(counts);
+
+        tree.update('b');
+        ASSERT_EQ(tree[HuffTree::ROOT].count, COUNT_CEILING - 1);
+        ASSERT_EQ(tree[tree.get_leaf('b')].count, 2);
+        tree.update('a');
+        ASSERT_EQ(tree[HuffTree::ROOT].count, COUNT_CEILING / 2);
+        ASSERT_EQ(tree[tree.get_leaf('b')].count, 1);
+        tree.validate();
+    }
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "../libs/io.hpp"
+#include "../libs/huffman.hpp"
+
+using namespace hf;
+
+static std::string temp_path(const char* name) {
+    return testing::TempDir() + name;
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+static void write_file(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary);
+    out << data;
+}
+
+TEST (IoTest, FileSourceMapped) {
+    std::string path = temp_path("io_source");
+    std::string data(100000, 'x');
+    data[5] = '\0';
+    write_file(path, data);
+
+    io::FileSource source(path);
+    ASSERT_TRUE(source.is_mapped());
+    ASSERT_EQ(source.remaining(), data.size());
+
+    std::string storage;
+    const char* span;
+    ASSERT_EQ(source.read(span, 60000, storage), 60000);
+    ASSERT_EQ(std::string(span, 60000), data.substr(0, 60000));
+    // points into the mapping
+    ASSERT_TRUE(storage.empty());
+
+    ASSERT_EQ(source.read(span, 60000, storage), 40000);
+    ASSERT_EQ(std::string(span, 40000), data.substr(60000));
+    ASSERT_EQ(source.read(span, 60000, storage), 0);
+    ASSERT_EQ(source.remaining(), 0);
+
+    std::remove(path.c_str());
+}
+
+TEST (IoTest, FileSourceEmpty) {
+    std::string path = temp_path("io_empty");
+    write_file(path, "");
+
+    io::FileSource source(path);
+    std::string storage;
+    const char* span;
+    ASSERT_EQ(source.remaining(), 0);
+    ASSERT_EQ(source.read(span, 100, storage), 0);
+
+    std::remove(path.c_str());
+}
+
+TEST (IoTest, FileSourcePipe) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    std::string data(200000, 'y');
+    std::thread writer([&]() {
+        // small writes, reader has to collect them
+        for (size_t i=0; i<data.size(); i+=1000) {
+            ASSERT_EQ(write(fds[1], data.data() + i, 1000), 1000);
+        }
+        close(fds[1]);
+    });
+
+    io::FileSource source("/dev/fd/" + std::to_string(fds[0]));
+    ASSERT_FALSE(source.is_mapped());
+    ASSERT_EQ(source.remaining(), io::UNKNOWN_SIZE);
+
+    std::string storage;
+    const char* span;
+    ASSERT_EQ(source.read(span, 150000, storage), 150000);
+    ASSERT_EQ(source.read(span, 150000, storage), 50000);
+    ASSERT_EQ(source.read(span, 150000, storage), 0);
+
+    writer.join();
+    close(fds[0]);
+}
+
+TEST (IoTest, FileSourceMissing) {
+    ASSERT_THROW(io::FileSource(temp_path("io_does_not_exist")), std::runtime_error);
+}
+
+TEST (IoTest, FileSink) {
+    std::string path = temp_path("io_sink");
+    std::string big(3 << 20, 'z');
+
+    {
+        io::FileSink sink(path);
+        sink.reserve(big.size() + 6);
+        sink.write("abc", 3);
+        sink.write(big.data(), big.size());
+        sink.write("def", 3);
+        sink.flush();
+    }
+
+    ASSERT_EQ(read_file(path), "abc" + big + "def");
+    std::remove(path.c_str());
+}
+
+TEST (IoTest, FileRoundTrip) {
+    std::string raw_path = temp_path("io_raw");
+    std::string packed_path = temp_path("io_packed");
+    std::string decoded_path = temp_path("io_decoded");
+
+    std::string data;
+    for (int i=0; i<100000; i++) {
+        data += (char)(i * i % 251);
+    }
+    write_file(raw_path, data);
+
+    {
+        io::FileSource src(raw_path);
+        io::FileSink dest(packed_path);
+        Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.set_frame_size(40000);
+        coder.encode();
+    }
+    {
+        io::FileSource src(packed_path);
+        io::FileSink dest(decoded_path);
+        Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.decode();
+    }
+
+    ASSERT_EQ(read_file(decoded_path), data);
+
+    std::remove(raw_path.c_str());
+    std::remove(packed_path.c_str());
+    std::remove(decoded_path.c_str());
+}
+
+TEST (IoTest, MemoryRoundTrip) {
+    std::string data(50000, '\0');
+    for (size_t i=0; i<data.size(); i++) {
+        data[i] = i * 7 % 13;
+    }
+
+    io::MemorySource source(data.data(), data.size());
+    std::string storage;
+    const char* span;
+    ASSERT_EQ(source.read(span, 30000, storage), 30000);
+    // points into the buffer
+    ASSERT_EQ(span, data.data());
+    ASSERT_EQ(source.remaining(), 20000);
+
+    std::string packed, decoded;
+    {
+        io::MemorySource src(data.data(), data.size());
+        io::StringSink dest(packed);
+        Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.encode();
+    }
+    {
+        io::MemorySource src(packed.data(), packed.size());
+        io::StringSink dest(decoded);
+        Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.decode();
+    }
+
+    ASSERT_EQ(decoded, data);
+}
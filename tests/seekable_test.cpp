@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "../libs/seekable.hpp"
+#include "../libs/huffman.hpp"
+#include "../libs/chunked.hpp"
+
+static std::string sample(size_t size) {
+    std::mt19937 gen(9);
+    std::geometric_distribution<int> dist(0.1);
+
+    std::string data(size, 0);
+    for (char& c : data) {
+        c = 'a' + dist(gen) % 40;
+    }
+
+    return data;
+}
+
+// like a pipe, length isn't known in advance
+class PipeSource : public hf::io::MemorySource {
+public:
+    using MemorySource::MemorySource;
+    uint64_t remaining() const override { return hf::io::UNKNOWN_SIZE; }
+};
+
+static std::string pack_seekable(const std::string& data, uint32_t frame_size, bool known_length,
+                                 const hf::Dictionary* dictionary = nullptr) {
+    std::string packed;
+    hf::io::MemorySource memory(data.data(), data.size());
+    PipeSource pipe(data.data(), data.size());
+    hf::io::StringSink sink(packed);
+
+    hf::Huffman coder(known_length ? (hf::io::Source&)memory : (hf::io::Source&)pipe, sink);
+    coder.set_verbose(false);
+    coder.set_frame_size(frame_size);
+    coder.set_seekable(true);
+    coder.set_dictionary(dictionary);
+    coder.encode();
+
+    return packed;
+}
+
+TEST (SeekableTest, Ranges) {
+    std::string data = sample(50000);
+
+    for (bool known_length : { true, false }) {
+        std::string packed = pack_seekable(data, 4096, known_length);
+        hf::SeekableReader reader(packed.data(), packed.size());
+        ASSERT_EQ(reader.get_length(), data.size());
+        ASSERT_EQ(reader.get_frames(), (data.size() + 4095) / 4096);
+
+        std::mt19937 gen(10);
+        std::uniform_int_distribution<uint64_t> offset(0, data.size() + 100);
+        std::uniform_int_distribution<uint64_t> length(0, 10000);
+        for (int i=0; i<100; i++) {
+            uint64_t o = offset(gen);
+            uint64_t l = length(gen);
+
+            std::string out;
+            reader.read(o, l, out);
+            ASSERT_EQ(out, o < data.size() ? data.substr(o, l) : "");
+        }
+
+        // one frame is decoded for a range inside it
+        size_t decoded = reader.get_frames_decoded();
+        std::string out;
+        reader.read(4096 * 5 + 10, 100, out);
+        ASSERT_EQ(reader.get_frames_decoded(), decoded + 1);
+
+        // sequential decoders ignore the index
+        std::istringstream src(packed);
+        std::ostringstream dest;
+        hf::Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.decode();
+        ASSERT_EQ(dest.str(), data);
+    }
+
+    std::string empty = pack_seekable("", 4096, true);
+    hf::SeekableReader reader(empty.data(), empty.size());
+    std::string out;
+    reader.read(0, 10, out);
+    ASSERT_EQ(out, "");
+}
+
+TEST (SeekableTest, Dictionary) {
+    std::string data = sample(20000);
+    detail::Histogram histogram = { };
+    detail::count_bytes(data.data(), 1000, histogram);
+    hf::Dictionary dictionary(histogram, detail::VITTER);
+
+    std::string packed = pack_seekable(data, 1000, true, &dictionary);
+    hf::SeekableReader reader(packed.data(), packed.size());
+
+    std::string out;
+    ASSERT_THROW(reader.read(5000, 10, out), std::runtime_error);
+
+    reader.set_dictionary(&dictionary);
+    reader.read(5000, 3000, out);
+    ASSERT_EQ(out, data.substr(5000, 3000));
+}
+
+TEST (SeekableTest, Corrupt) {
+    std::string data = sample(20000);
+    std::string packed = pack_seekable(data, 1000, true);
+
+    // not seekable
+    std::istringstream src(data);
+    std::ostringstream dest;
+    hf::Huffman coder(src, dest);
+    coder.set_verbose(false);
+    coder.encode();
+    std::string plain = dest.str();
+    ASSERT_THROW(hf::SeekableReader(plain.data(), plain.size()), std::runtime_error);
+
+    // index or frames
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<size_t> pos(hf::container::HEADER_SIZE, packed.size() - 1);
+    for (int i=0; i<100; i++) {
+        std::string corrupt = packed;
+        size_t at = i < 50 ? packed.size() - 1 - i * 4 : pos(gen);
+        corrupt[at] ^= 1 << (i % 8);
+
+        ASSERT_THROW({
+            hf::SeekableReader reader(corrupt.data(), corrupt.size());
+            std::string out;
+            reader.read(0, data.size(), out);
+        }, std::runtime_error);
+    }
+}
+
+TEST (SeekableTest, Checkpoints) {
+    std::string data = sample(50000);
+
+    std::string packed;
+    hf::io::MemorySource memory(data.data(), data.size());
+    hf::io::StringSink sink(packed);
+    hf::Huffman coder(memory, sink);
+    coder.set_verbose(false);
+    coder.set_frame_size(4096);
+    coder.set_checkpoints(3);
+    coder.encode();
+
+    ASSERT_EQ(packed[5] & (hf::container::FLAG_SEEKABLE | hf::container::FLAG_INDEPENDENT), hf::container::FLAG_SEEKABLE);
+
+    hf::SeekableReader reader(packed.data(), packed.size());
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<uint64_t> offset(0, data.size() - 1);
+    for (int i=0; i<50; i++) {
+        uint64_t o = offset(gen);
+
+        std::string out;
+        reader.read(o, 5000, out);
+        ASSERT_EQ(out, data.substr(o, 5000));
+    }
+
+    // frames from the checkpoint (frame 3), then the next one continues
+    size_t decoded = reader.get_frames_decoded();
+    std::string out;
+    reader.read(4096 * 5 + 10, 100, out);
+    ASSERT_EQ(reader.get_frames_decoded(), decoded + 3);
+    reader.read(4096 * 6 + 10, 100, out);
+    ASSERT_EQ(reader.get_frames_decoded(), decoded + 4);
+
+    // sequential and parallel decoders
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::Huffman decoder(src, dest);
+    decoder.set_verbose(false);
+    decoder.decode();
+    ASSERT_EQ(dest.str(), data);
+
+    std::string parallel;
+    hf::io::MemorySource packed_source(packed.data(), packed.size());
+    hf::io::StringSink parallel_sink(parallel);
+    hf::ChunkedHuffman chunked(packed_source, parallel_sink, 3, 4096);
+    chunked.decode();
+    ASSERT_EQ(parallel, data);
+
+    // snapshot of the first checkpoint is corrupt (symbol count)
+    std::string corrupt = packed;
+    corrupt[hf::container::HEADER_SIZE + 8 + 2] = 0x7F;
+    std::istringstream corrupt_src(corrupt);
+    std::ostringstream corrupt_dest;
+    hf::Huffman corrupt_decoder(corrupt_src, corrupt_dest);
+    corrupt_decoder.set_verbose(false);
+    ASSERT_THROW(corrupt_decoder.decode(), std::runtime_error);
+}
+
+// continues packed (appendable) with part, like --append
+static void append(std::string& packed, const std::string& part, bool aging,
+                   int count_limit = hf::container::CHECKPOINT_COUNT_LIMIT) {
+    std::string old = packed;
+    hf::io::MemorySource memory(part.data(), part.size());
+    hf::io::StringSink sink(packed);
+
+    hf::Huffman coder(memory, sink);
+    coder.set_verbose(false);
+    coder.set_frame_size(4096);
+    coder.set_aging(aging);
+    coder.set_checkpoint_count_limit(count_limit);
+    coder.set_appendable(true);
+    if (!old.empty()) {
+        packed.resize(coder.resume(old.data(), old.size()));
+    }
+    coder.encode();
+}
+
+TEST (SeekableTest, Append) {
+    std::string data = sample(50000);
+
+    for (bool aging : { false, true }) {
+        // partial frames, a full one and an empty part
+        std::string packed;
+        size_t ends[] = { 10000, 4096 * 3, 4096 * 3, 30000, data.size() };
+        size_t start = 0;
+        for (size_t end : ends) {
+            append(packed, data.substr(start, end - start), aging);
+            start = end;
+        }
+
+        std::istringstream src(packed);
+        std::ostringstream dest;
+        hf::Huffman decoder(src, dest);
+        decoder.set_verbose(false);
+        decoder.decode();
+        ASSERT_EQ(dest.str(), data);
+
+        hf::SeekableReader reader(packed.data(), packed.size());
+        ASSERT_EQ(reader.get_length(), data.size());
+        std::string out;
+        reader.read(9000, 25000, out);
+        ASSERT_EQ(out, data.substr(9000, 25000));
+
+        // model at the end is checked
+        std::string corrupt = packed;
+        std::vector<uint64_t> offsets;
+        hf::container::read_index(packed.data(), packed.size(), offsets);
+        corrupt[hf::container::index_start(packed.size(), offsets.size()) - hf::container::MODEL_TRAILER_SIZE - 1] ^= 1;
+        hf::io::MemorySource empty(nullptr, 0);
+        std::string sink_target;
+        hf::io::StringSink sink(sink_target);
+        ASSERT_THROW(hf::Huffman(empty, sink).resume(corrupt.data(), corrupt.size()), std::runtime_error);
+    }
+
+    // streams without the model can't be continued
+    std::string seekable = pack_seekable(data, 4096, false);
+    hf::io::MemorySource empty(nullptr, 0);
+    std::string sink_target;
+    hf::io::StringSink sink(sink_target);
+    ASSERT_THROW(hf::Huffman(empty, sink).resume(seekable.data(), seekable.size()), std::runtime_error);
+}
+
+TEST (SeekableTest, CheckpointCountLimit) {
+    std::string data = sample(50000);
+
+    // no checkpoints but the first one, counts cross the limit every few frames
+    std::string packed;
+    hf::io::MemorySource memory(data.data(), data.size());
+    hf::io::StringSink sink(packed);
+    hf::Huffman coder(memory, sink);
+    coder.set_verbose(false);
+    coder.set_frame_size(4096);
+    coder.set_checkpoints(1000);
+    coder.set_checkpoint_count_limit(10000);
+    coder.encode();
+
+    std::istringstream src(packed);
+    std::ostringstream dest;
+    hf::Huffman decoder(src, dest);
+    decoder.set_verbose(false);
+    decoder.decode();
+    ASSERT_EQ(dest.str(), data);
+
+    // decoding starts at a checkpoint made by the limit
+    hf::SeekableReader reader(packed.data(), packed.size());
+    std::string out;
+    reader.read(4096 * 10 + 10, 100, out);
+    ASSERT_EQ(out, data.substr(4096 * 10 + 10, 100));
+    ASSERT_LE(reader.get_frames_decoded(), 3u);
+
+    // halved counts are carried over by the model of appendable streams
+    std::string appended;
+    append(appended, data.substr(0, 20000), false, 10000);
+    append(appended, data.substr(20000), false, 10000);
+
+    std::istringstream appended_src(appended);
+    std::ostringstream appended_dest;
+    hf::Huffman appended_decoder(appended_src, appended_dest);
+    appended_decoder.set_verbose(false);
+    appended_decoder.decode();
+    ASSERT_EQ(appended_dest.str(), data);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../libs/spsc_ring.hpp"
+#include "../libs/pipeline.hpp"
+
+using namespace detail;
+
+TEST (SpscRingTest, FullEmpty) {
+    SpscRing<int, 4> ring;
+    int item;
+
+    ASSERT_TRUE(ring.is_empty());
+    ASSERT_FALSE(ring.try_pop(item));
+
+    for (int i=0; i<4; i++) {
+        ASSERT_TRUE(ring.try_push(i));
+    }
+    ASSERT_FALSE(ring.try_push(4));
+    ASSERT_EQ(ring.size(), 4);
+
+    for (int i=0; i<4; i++) {
+        ASSERT_TRUE(ring.try_pop(item));
+        ASSERT_EQ(item, i);
+    }
+    ASSERT_FALSE(ring.try_pop(item));
+}
+
+TEST (SpscRingTest, WrapAround) {
+    SpscRing<int, 4> ring;
+    int item;
+
+    for (int i=0; i<100; i++) {
+        ASSERT_TRUE(ring.try_push(i));
+        ASSERT_TRUE(ring.try_push(-i));
+        ASSERT_TRUE(ring.try_pop(item));
+        ASSERT_EQ(item, i);
+        ASSERT_TRUE(ring.try_pop(item));
+        ASSERT_EQ(item, -i);
+    }
+}
+
+TEST (SpscRingTest, TwoThreads) {
+    SpscRing<unsigned int, 8> ring;
+    const unsigned int count = 200000;
+
+    std::thread producer([&]() {
+        for (unsigned int i=0; i<count; i++) {
+            while (!ring.try_push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    unsigned int item;
+    for (unsigned int i=0; i<count; i++) {
+        while (!ring.try_pop(item)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(item, i);
+    }
+
+    producer.join();
+}
+
+TEST (PipelineTest, InOrder) {
+    Pipeline<int, std::string> pipeline;
+
+    int next = 0;
+    std::vector<std::string> written;
+
+    // run twice, buffers are reused
+    for (int run=0; run<2; run++) {
+        next = 0;
+        written.clear();
+
+        pipeline.run(
+            [&](int& in) { in = next++; return in < 1000; },
+            [&](int& in, std::string& out) { out = std::to_string(in * 2); },
+            [&](std::string& out) { written.push_back(out); });
+
+        ASSERT_EQ(written.size(), 1000);
+        for (int i=0; i<1000; i++) {
+            ASSERT_EQ(written[i], std::to_string(i * 2));
+        }
+    }
+}
+
+TEST (PipelineTest, Errors) {
+    for (int stage=0; stage<3; stage++) {
+        Pipeline<int, int> pipeline;
+        int next = 0;
+
+        auto fail = [&](int stage_here, int value) {
+            if (stage == stage_here && value == 100) {
+                throw std::runtime_error("stage " + std::to_string(stage));
+            }
+        };
+
+        // never ending input, has to stop because of the error
+        ASSERT_THROW(pipeline.run(
+            [&](int& in) { in = next++; fail(0, in); return true; },
+            [&](int& in, int& out) { fail(1, in); out = in; },
+            [&](int& out) { fail(2, out); }), std::runtime_error);
+    }
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../libs/stats.hpp"
+#include "../libs/huffman.hpp"
+
+using namespace detail;
+
+TEST (StatsTest, Merge) {
+    Stats a, b;
+    a.symbols = 3;
+    a.code_lengths[2] = 1;
+    a.max_code_length = 2;
+    b.symbols = 4;
+    b.code_lengths[2] = 2;
+    b.max_code_length = 7;
+
+    a += b;
+    ASSERT_EQ(a.symbols, 7);
+    ASSERT_EQ(a.code_lengths[2], 3);
+    ASSERT_EQ(a.max_code_length, 7);
+
+    std::ostringstream json;
+    write_stats_json(json, a);
+    ASSERT_NE(json.str().find("\"symbols\": 7"), std::string::npos);
+    ASSERT_NE(json.str().find("\"code_lengths\": {\"2\": 3}"), std::string::npos);
+}
+
+TEST (StatsTest, Counters) {
+    if (!stats_enabled()) {
+        GTEST_SKIP() << "built without HF_STATS";
+    }
+
+    std::string data;
+    for (int i=0; i<10000; i++) {
+        data += (char)(i * i % 37);
+    }
+
+    // counted on another thread, merged when it exits
+    Stats before = collect_stats();
+    std::thread worker([&]() {
+        std::istringstream src(data);
+        std::ostringstream dest;
+        hf::Huffman coder(src, dest);
+        coder.set_verbose(false);
+        coder.encode();
+    });
+    worker.join();
+    Stats after = collect_stats();
+
+    ASSERT_EQ(after.symbols - before.symbols, data.size());
+    // squares mod 37 take 19 values
+    ASSERT_EQ(after.nyt_escapes - before.nyt_escapes, 19);
+    ASSERT_GT(after.swaps, before.swaps);
+    ASSERT_GT(after.model_ns, before.model_ns);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <set>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+
+#include "../libs/thread_pool.hpp"
+
+using namespace detail;
+
+TEST (ThreadPoolTest, NestedJobs) {
+    ThreadPool pool(4);
+    std::atomic<int> done(0);
+
+    // every job splits into smaller ones
+    for (int i=0; i<10; i++) {
+        pool.submit([&](unsigned int) {
+            for (int j=0; j<100; j++) {
+                pool.submit([&](unsigned int) { done++; });
+            }
+            done++;
+        });
+    }
+
+    pool.wait();
+    ASSERT_EQ(done, 10 * 101);
+
+    // reusable after wait()
+    pool.submit([&](unsigned int) { done++; });
+    pool.wait();
+    ASSERT_EQ(done, 10 * 101 + 1);
+}
+
+TEST (ThreadPoolTest, Stealing) {
+    ThreadPool pool(4);
+    std::mutex mutex;
+    std::set<unsigned int> workers;
+
+    // all jobs land in the queue of one worker, the others have to steal them
+    pool.submit([&](unsigned int) {
+        for (int j=0; j<64; j++) {
+            pool.submit([&](unsigned int worker) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                workers.insert(worker);
+            });
+        }
+    });
+
+    pool.wait();
+    ASSERT_GT(workers.size(), 1);
+    for (unsigned int worker : workers) {
+        ASSERT_LT(worker, pool.size());
+    }
+}
+
+TEST (ThreadPoolTest, Exception) {
+    ThreadPool pool(3);
+    std::atomic<int> done(0);
+
+    for (int i=0; i<20; i++) {
+        pool.submit([&, i](unsigned int) {
+            if (i == 7) {
+                throw std::runtime_error("job failed");
+            }
+            done++;
+        });
+    }
+
+    ASSERT_THROW(pool.wait(), std::runtime_error);
+    ASSERT_EQ(done, 19);
+
+    // error is reported once
+    pool.wait();
+}